@@ -605,6 +605,10 @@ add_test(NAME Parameter_01
 	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
          COMMAND ../build/topas Parameter_01.txt)
 
+add_test(NAME Parameter_02
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas Parameter_02.txt)
+
 add_test(NAME PhaseSpace_01A
 	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
          COMMAND ../build/topas PhaseSpace_01A.txt)
@@ -673,6 +677,50 @@ add_test(NAME PhaseSpace_03E
 	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
          COMMAND ../build/topas PhaseSpace_03E.txt)
 
+add_test(NAME PhaseSpace_04A
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas PhaseSpace_04A.txt)
+
+add_test(NAME PhaseSpace_04B
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas PhaseSpace_04B.txt)
+
+add_test(NAME PhaseSpace_05A
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas PhaseSpace_05A.txt)
+
+add_test(NAME PhaseSpace_05B
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas PhaseSpace_05B.txt)
+
+add_test(NAME PhaseSpace_06A
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas PhaseSpace_06A.txt)
+
+add_test(NAME PhaseSpaceTool_01A
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topasphsp PhaseSpaceTool_01A.txt)
+
+add_test(NAME PhaseSpaceTool_01B
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topasphsp PhaseSpaceTool_01B.txt)
+
+add_test(NAME PhaseSpaceTool_01C
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topasphsp PhaseSpaceTool_01C.txt)
+
+add_test(NAME PhaseSpaceTool_01D
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topasphsp PhaseSpaceTool_01D.txt)
+
+add_test(NAME PhaseSpaceTool_01E
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topasphsp PhaseSpaceTool_01E.txt)
+
+add_test(NAME PhaseSpaceTool_02A
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas PhaseSpaceTool_02A.txt)
+
 add_test(NAME Primary_01
 	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
          COMMAND ../build/topas Primary_01.txt)
@@ -761,6 +809,10 @@ add_test(NAME Scoring_07
 	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
          COMMAND ../build/topas Scoring_07.txt)
 
+add_test(NAME Sweep_01
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas Sweep_01.txt)
+
 add_test(NAME TimeFeature_01
 	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
          COMMAND ../build/topas TimeFeature_01.txt)
@@ -781,6 +833,18 @@ add_test(NAME TimeFeature_05
 	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
          COMMAND ../build/topas TimeFeature_05.txt)
 
+add_test(NAME TimeFeature_06
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas TimeFeature_06.txt)
+
+add_test(NAME TimeFeature_07
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas TimeFeature_07.txt)
+
+add_test(NAME TimeFeature_08
+	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
+         COMMAND ../build/topas TimeFeature_08.txt)
+
 add_test(NAME vrt_CutByRegions
 	 WORKING_DIRECTORY /home/runner/work/topas/topas/tests
          COMMAND ../build/topas vrt_CutByRegions.txt)
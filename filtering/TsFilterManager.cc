@@ -114,7 +114,8 @@ void TsFilterManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 		G4bool matched = false;
 		std::multimap< G4String, std::pair<TsVFilter*,G4String> >::const_iterator iter;
-		for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end() && !matched; iter++) {
+		std::multimap< G4String, std::pair<TsVFilter*,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(nameToLower);
+		for (iter = fChangeableParameterMap.lower_bound(nameToLower); iter != last && !matched; iter++) {
 			G4String gotParm = iter->first;
 			TsVFilter* gotFilter = iter->second.first;
 			G4String gotDirectParm = iter->second.second;
@@ -129,6 +130,7 @@ void TsFilterManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 		if (!matched) {
 #ifdef TOPAS_MT
 			fChangeableParameterMap.insert(std::make_pair(nameToLower, std::make_pair(fCurrentFilter.Get(), directParm)));
+			fPm->RegisterParameterConsumer(name, "filter", fCurrentFilter.Get()->GetName(), directParm);
 			if (fTfVerbosity > 0)
 				G4cout << "Registered use of changeable parameter: " << name << "  by filter: " << fCurrentFilter.Get()->GetName() << G4endl;
 		}
@@ -141,6 +143,7 @@ void TsFilterManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 			", lastDirectParam: " << fPm->GetLastDirectParameterName() << ", lastDirectAction: " << fPm->GetLastDirectAction() << G4endl;
 #else
 		fChangeableParameterMap.insert(std::make_pair(nameToLower, std::make_pair(fCurrentFilter, directParm)));
+		fPm->RegisterParameterConsumer(name, "filter", fCurrentFilter->GetName(), directParm);
 		if (fTfVerbosity > 0)
 			G4cout << "Registered use of changeable parameter: " << name << "  by filter: " << fCurrentFilter->GetName() << G4endl;
 	}
@@ -158,7 +161,8 @@ void TsFilterManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 void TsFilterManager::UpdateForSpecificParameterChange(G4String parameter) {
 	std::multimap< G4String, std::pair<TsVFilter*,G4String> >::const_iterator iter;
-	for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end(); iter++) {
+	std::multimap< G4String, std::pair<TsVFilter*,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(parameter);
+	for (iter = fChangeableParameterMap.lower_bound(parameter); iter != last; iter++) {
 		if (iter->first==parameter) {
 			G4String directParameterName = iter->second.second;
 			if (fTfVerbosity > 0)
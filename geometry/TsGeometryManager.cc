@@ -308,7 +308,8 @@ void TsGeometryManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 		G4StrUtil::to_lower(nameToLower);
 		G4bool matched = false;
 		std::multimap<G4String,std::pair<G4String,G4String> >::const_iterator iter;
-		for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end() && !matched; iter++) {
+		std::multimap<G4String,std::pair<G4String,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(nameToLower);
+		for (iter = fChangeableParameterMap.lower_bound(nameToLower); iter != last && !matched; iter++) {
 			G4String gotParm = iter->first;
 			G4String gotComp = iter->second.first;
 			G4String gotDirectParm = iter->second.second;
@@ -318,6 +319,7 @@ void TsGeometryManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 		if (!matched) {
 			fChangeableParameterMap.insert(std::make_pair(nameToLower, std::make_pair(comp, directParm)));
+			fPm->RegisterParameterConsumer(name, "component", comp, directParm);
 			if (fPm->IGetIntegerParameter("Tf/Verbosity") > 0)
 				G4cout << "Registered use of changeable parameter: " << name << "  by component: " << fCurrentComponent->GetNameWithCopyId() << G4endl;
 		}
@@ -352,7 +354,8 @@ void TsGeometryManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 		G4StrUtil::to_lower(nameToLower);
 		G4bool matched = false;
 		std::multimap<G4String,std::pair<G4String,G4String> >::const_iterator iter;
-		for (iter = fChangeableMagneticFieldParameterMap.begin(); iter != fChangeableMagneticFieldParameterMap.end() && !matched; iter++) {
+		std::multimap<G4String,std::pair<G4String,G4String> >::const_iterator last = fChangeableMagneticFieldParameterMap.upper_bound(nameToLower);
+		for (iter = fChangeableMagneticFieldParameterMap.lower_bound(nameToLower); iter != last && !matched; iter++) {
 			G4String gotParm = iter->first;
 			G4String gotComp = iter->second.first;
 			G4String gotDirectParm = iter->second.second;
@@ -362,6 +365,7 @@ void TsGeometryManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 		if (!matched) {
 			fChangeableMagneticFieldParameterMap.insert(std::make_pair(nameToLower, std::make_pair(comp, directParm)));
+			fPm->RegisterParameterConsumer(name, "magnetic field of component", comp, directParm);
 			if (fPm->IGetIntegerParameter("Tf/Verbosity") > 0)
 				G4cout << "Registered use of changeable magnetic field parameter: " << name << "  by component: " << mComponent->GetNameWithCopyId() << G4endl;
 		}
@@ -396,7 +400,8 @@ void TsGeometryManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 		G4StrUtil::to_lower(nameToLower);
 		G4bool matched = false;
 		std::multimap<G4String,std::pair<G4String,G4String> >::const_iterator iter;
-		for (iter = fChangeableElectroMagneticFieldParameterMap.begin(); iter != fChangeableElectroMagneticFieldParameterMap.end() && !matched; iter++) {
+		std::multimap<G4String,std::pair<G4String,G4String> >::const_iterator last = fChangeableElectroMagneticFieldParameterMap.upper_bound(nameToLower);
+		for (iter = fChangeableElectroMagneticFieldParameterMap.lower_bound(nameToLower); iter != last && !matched; iter++) {
 			G4String gotParm = iter->first;
 			G4String gotComp = iter->second.first;
 			G4String gotDirectParm = iter->second.second;
@@ -406,6 +411,7 @@ void TsGeometryManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 		if (!matched) {
 			fChangeableElectroMagneticFieldParameterMap.insert(std::make_pair(nameToLower, std::make_pair(comp, directParm)));
+			fPm->RegisterParameterConsumer(name, "electromagnetic field of component", comp, directParm);
 			if (fPm->IGetIntegerParameter("Tf/Verbosity") > 0)
 				G4cout << "Registered use of changeable electric field parameter: " << name << "  by component: " << mComponent->GetNameWithCopyId() << G4endl;
 		}
@@ -422,7 +428,8 @@ void TsGeometryManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 void TsGeometryManager::UpdateForSpecificParameterChange(G4String parameter) {
 	std::multimap<G4String,std::pair<G4String,G4String> >::const_iterator iter;
-	for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end(); iter++) {
+	std::multimap<G4String,std::pair<G4String,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(parameter);
+	for (iter = fChangeableParameterMap.lower_bound(parameter); iter != last; iter++) {
 		if (iter->first==parameter) {
 			G4String directParameterName = iter->second.second;
 			G4String compName = iter->second.first;
@@ -440,7 +447,8 @@ void TsGeometryManager::UpdateForSpecificParameterChange(G4String parameter) {
 		}
 	}
 
-	for (iter = fChangeableMagneticFieldParameterMap.begin(); iter != fChangeableMagneticFieldParameterMap.end(); iter++) {
+	last = fChangeableMagneticFieldParameterMap.upper_bound(parameter);
+	for (iter = fChangeableMagneticFieldParameterMap.lower_bound(parameter); iter != last; iter++) {
 		if (iter->first==parameter) {
 			G4String directParameterName = iter->second.second;
 			G4String compName = iter->second.first;
@@ -458,7 +466,8 @@ void TsGeometryManager::UpdateForSpecificParameterChange(G4String parameter) {
 		}
 	}
 
-	for (iter = fChangeableElectroMagneticFieldParameterMap.begin(); iter != fChangeableElectroMagneticFieldParameterMap.end(); iter++) {
+	last = fChangeableElectroMagneticFieldParameterMap.upper_bound(parameter);
+	for (iter = fChangeableElectroMagneticFieldParameterMap.lower_bound(parameter); iter != last; iter++) {
 		if (iter->first==parameter) {
 			G4String directParameterName = iter->second.second;
 			G4String compName = iter->second.first;
@@ -495,8 +504,10 @@ G4bool TsGeometryManager::UpdateForNewRun(TsSequenceManager* sqM, G4bool forceUp
 	if (fPm->GetBooleanParameter("Ts/DisableReoptimizeTestMode"))
 		G4cout << "TsGeometryManager::UpdateForNewRun ignoring request to reoptimize volumes since Ts/DisableReoptimizeTestMode has been set true." << G4endl;
 	else
-		for (iter = fReoptimizeVolumes.begin(); iter != fReoptimizeVolumes.end(); ++iter)
+		for (iter = fReoptimizeVolumes.begin(); iter != fReoptimizeVolumes.end(); ++iter) {
+			fPm->NoteRebuildForRun("Reoptimized volume: " + (*iter)->GetName());
 			sqM->ReOptimize(*iter);
+		}
 	fReoptimizeVolumes.clear();
 
 	if (fVerbosity>0)
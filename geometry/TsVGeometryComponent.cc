@@ -1379,6 +1379,7 @@ G4bool TsVGeometryComponent::RebuildIfNeeded() {
 	if (fNeedToRebuild) {
 		if (fVerbosity>0)
 			G4cout << "Rebuilding: " << GetNameWithCopyId() << G4endl;
+		fPm->NoteRebuildForRun("Rebuilt component: " + GetNameWithCopyId());
 		DeleteContents();
 		Construct();
 		InstantiateFields();
@@ -1403,6 +1404,8 @@ void TsVGeometryComponent::UpdateForNewRun(G4bool force) {
 
 	// Never update the World component even if in force mode
 	if (fParentComponent && ( fNeedToUpdatePlacement || force ) ) {
+		if (fNeedToUpdatePlacement)
+			fPm->NoteRebuildForRun("Updated placement of component: " + GetNameWithCopyId());
 		CalculatePlacement();
 		fExtent = G4VisExtent::GetNullExtent();
 		if (!fIsGroup) {
@@ -197,7 +197,8 @@ void TsGraphicsManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 		G4StrUtil::to_lower(nameToLower);
 
 		std::multimap< G4String, std::pair<TsGraphicsView*, G4String> >::const_iterator iter;
-		for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end() && !matched; iter++) {
+		std::multimap< G4String, std::pair<TsGraphicsView*, G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(nameToLower);
+		for (iter = fChangeableParameterMap.lower_bound(nameToLower); iter != last && !matched; iter++) {
 			G4String gotParm = iter->first;
 			TsGraphicsView* gotView = iter->second.first;
 			G4String gotDirectParm = iter->second.second;
@@ -207,6 +208,7 @@ void TsGraphicsManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 		if (!matched) {
 			fChangeableParameterMap.insert(std::make_pair(nameToLower, std::make_pair(fCurrentView, directParm)));
+			fPm->RegisterParameterConsumer(name, "view", fCurrentView->GetName(), directParm);
 			if (fPm->IGetIntegerParameter("Tf/Verbosity") > 0)
 				G4cout << "Registered use of changeable parameter: " << name << "  by view: " << fCurrentView->GetName() << G4endl;
 		}
@@ -223,7 +225,8 @@ void TsGraphicsManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 void TsGraphicsManager::UpdateForSpecificParameterChange(G4String parameter) {
 	std::multimap< G4String, std::pair<TsGraphicsView*,G4String> >::const_iterator iter;
-	for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end(); iter++) {
+	std::multimap< G4String, std::pair<TsGraphicsView*,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(parameter);
+	for (iter = fChangeableParameterMap.lower_bound(parameter); iter != last; iter++) {
 		if (iter->first==parameter) {
 			G4String directParameterName = iter->second.second;
 			if (fVerbosity>0)
@@ -0,0 +1,648 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#include "TsPhaseSpaceToolkit.hh"
+
+#include "TsParameterManager.hh"
+#include "TsNtupleAscii.hh"
+#include "TsNtupleBinary.hh"
+#include "TsPhaseSpaceIndex.hh"
+#include "TsPhaseSpacePrefetchBuffer.hh"
+
+#include "G4ParticleTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4BosonConstructor.hh"
+#include "G4LeptonConstructor.hh"
+#include "G4MesonConstructor.hh"
+#include "G4BaryonConstructor.hh"
+#include "G4IonConstructor.hh"
+#include "G4UIcommand.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <fstream>
+#include <sstream>
+#include <cmath>
+
+TsPhaseSpaceToolkit::Statistics::Statistics() :
+histories(0), nonEmptyHistories(0), particles(0)
+{
+}
+
+
+void TsPhaseSpaceToolkit::Statistics::AddParticle(const TsPhaseSpaceRecord& record)
+{
+	particles++;
+	numberOfParticles[record.particleCode]++;
+
+	std::map<G4int, G4double>::iterator itr = minimumKE.find(record.particleCode);
+	if (itr == minimumKE.end() || record.kEnergy < itr->second)
+		minimumKE[record.particleCode] = record.kEnergy;
+
+	itr = maximumKE.find(record.particleCode);
+	if (itr == maximumKE.end() || record.kEnergy > itr->second)
+		maximumKE[record.particleCode] = record.kEnergy;
+}
+
+
+TsPhaseSpaceToolkit::TsPhaseSpaceToolkit(TsParameterManager* pM) :
+fPm(pM), fOutputFile(""), fOutputType("binary"), fIfOutputFileAlreadyExists("Exit"), fHistoriesPerFile(0),
+fBufferSize(100000), fPrefetchDepth(4), fPrefetchBlockSize(4096),
+fFilterByParticle(false), fMinimumEnergy(0.), fMaximumEnergy(DBL_MAX),
+fLimitedAssumePhotonIsNewHistory(false), fLimitedAssumeEveryParticleIsNewHistory(false),
+fLimitedAssumeFirstParticleIsNewHistory(false),
+fInHistory(false), fHistoryHasOutput(false), fNumberOfUnsupportedParticles(0),
+fNtuple(0), fPartNumber(0), fPartHistories(0), fHeaderNumberOfHistories(0),
+fPosX(0.), fPosY(0.), fPosZ(0.), fCosX(0.), fCosY(0.), fEnergy(0.), fWeight(0.), fPType(0),
+fCosZIsNegative(false), fIsNewHistory(false), fSignedEnergy(0.), fSignedPType(0)
+{
+	if (!fPm->ParameterExists("Ps/InputFiles")) {
+		G4cerr << "Topas is exiting due to a serious error in phase space processing." << G4endl;
+		G4cerr << "The parameter Ps/InputFiles must name at least one phase space (without file extension)." << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	G4int numberOfInputs = fPm->GetVectorLength("Ps/InputFiles");
+	G4String* inputFiles = fPm->GetStringVector("Ps/InputFiles");
+	for (G4int i = 0; i < numberOfInputs; i++)
+		fInputFiles.push_back(inputFiles[i]);
+
+	if (fPm->ParameterExists("Ps/OutputFile"))
+		fOutputFile = fPm->GetStringParameter("Ps/OutputFile");
+
+	if (fPm->ParameterExists("Ps/OutputType"))
+		fOutputType = fPm->GetStringParameter("Ps/OutputType");
+	G4StrUtil::to_lower(fOutputType);
+	if (fOutputType != "ascii" && fOutputType != "binary" && fOutputType != "limited") {
+		G4cerr << "Topas is exiting due to a serious error in phase space processing." << G4endl;
+		G4cerr << "Ps/OutputType has unsupported value: " << fOutputType << G4endl;
+		G4cerr << "Value must be one of: ASCII, Binary or Limited" << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	if (fPm->ParameterExists("Ps/IfOutputFileAlreadyExists"))
+		fIfOutputFileAlreadyExists = fPm->GetStringParameter("Ps/IfOutputFileAlreadyExists");
+
+	if (fPm->ParameterExists("Ps/HistoriesPerFile")) {
+		fHistoriesPerFile = fPm->GetIntegerParameter("Ps/HistoriesPerFile");
+		if (fHistoriesPerFile <= 0) {
+			G4cerr << "Topas is exiting due to a serious error in phase space processing." << G4endl;
+			G4cerr << "Ps/HistoriesPerFile must be greater than zero." << G4endl;
+			fPm->AbortSession(1);
+		}
+	}
+
+	if (fPm->ParameterExists("Ps/KeepParticles")) {
+		fFilterByParticle = true;
+		G4int numberOfParticles = fPm->GetVectorLength("Ps/KeepParticles");
+		G4int* keepParticles = fPm->GetIntegerVector("Ps/KeepParticles");
+		for (G4int i = 0; i < numberOfParticles; i++)
+			fKeepParticles.insert(keepParticles[i]);
+	}
+
+	if (fPm->ParameterExists("Ps/MinimumEnergy"))
+		fMinimumEnergy = fPm->GetDoubleParameter("Ps/MinimumEnergy", "Energy");
+
+	if (fPm->ParameterExists("Ps/MaximumEnergy"))
+		fMaximumEnergy = fPm->GetDoubleParameter("Ps/MaximumEnergy", "Energy");
+
+	if (fPm->ParameterExists("Ps/BufferSize"))
+		fBufferSize = fPm->GetIntegerParameter("Ps/BufferSize");
+
+	if (fPm->ParameterExists("Ps/PrefetchDepth"))
+		fPrefetchDepth = fPm->GetIntegerParameter("Ps/PrefetchDepth");
+
+	if (fPm->ParameterExists("Ps/PrefetchBlockSize"))
+		fPrefetchBlockSize = fPm->GetIntegerParameter("Ps/PrefetchBlockSize");
+
+	if (fBufferSize <= 0 || fPrefetchDepth <= 0 || fPrefetchBlockSize <= 0) {
+		G4cerr << "Topas is exiting due to a serious error in phase space processing." << G4endl;
+		G4cerr << "Ps/BufferSize, Ps/PrefetchDepth and Ps/PrefetchBlockSize must be greater than zero." << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	if (fPm->ParameterExists("Ps/LimitedAssumePhotonIsNewHistory"))
+		fLimitedAssumePhotonIsNewHistory = fPm->GetBooleanParameter("Ps/LimitedAssumePhotonIsNewHistory");
+
+	if (fPm->ParameterExists("Ps/LimitedAssumeEveryParticleIsNewHistory"))
+		fLimitedAssumeEveryParticleIsNewHistory = fPm->GetBooleanParameter("Ps/LimitedAssumeEveryParticleIsNewHistory");
+
+	if (fPm->ParameterExists("Ps/LimitedAssumeFirstParticleIsNewHistory"))
+		fLimitedAssumeFirstParticleIsNewHistory = fPm->GetBooleanParameter("Ps/LimitedAssumeFirstParticleIsNewHistory");
+
+	// Particle definitions are only needed to name particles in headers and summaries
+	G4BosonConstructor pBosonConstructor;
+	pBosonConstructor.ConstructParticle();
+
+	G4LeptonConstructor pLeptonConstructor;
+	pLeptonConstructor.ConstructParticle();
+
+	G4MesonConstructor pMesonConstructor;
+	pMesonConstructor.ConstructParticle();
+
+	G4BaryonConstructor pBaryonConstructor;
+	pBaryonConstructor.ConstructParticle();
+
+	G4IonConstructor pIonConstructor;
+	pIonConstructor.ConstructParticle();
+}
+
+
+TsPhaseSpaceToolkit::~TsPhaseSpaceToolkit()
+{
+	delete fNtuple;
+}
+
+
+void TsPhaseSpaceToolkit::Run()
+{
+	if (!fOutputFile.empty())
+		OpenOutput();
+
+	for (size_t i = 0; i < fInputFiles.size(); i++)
+		ProcessInput(fInputFiles[i]);
+
+	// Empty histories that the input headers count beyond those stored in the files
+	// are appended to the end of the last output, as the phase space source would do.
+	G4long emptyHistoriesAtEnd = fHeaderNumberOfHistories - fInputStatistics.histories;
+	if (emptyHistoriesAtEnd < 0)
+		emptyHistoriesAtEnd = 0;
+
+	if (fNtuple)
+		CloseOutput(emptyHistoriesAtEnd);
+
+	G4cout << G4endl;
+	G4cout << "Summary of " << fInputFiles.size() << " input phase space file(s):" << G4endl;
+	G4cout << DescribeHistories(fInputStatistics, fInputStatistics.histories + emptyHistoriesAtEnd) << G4endl;
+	G4cout << DescribeParticles(fInputStatistics) << G4endl;
+
+	if (!fOutputFile.empty()) {
+		G4cout << "Written to " << fPartNumber << " output phase space file(s):" << G4endl;
+		G4cout << DescribeHistories(fOutputStatistics, fOutputStatistics.histories) << G4endl;
+	}
+
+	if (fNumberOfUnsupportedParticles > 0)
+		G4cout << "Particles left out because the format cannot store them: " << fNumberOfUnsupportedParticles << G4endl;
+}
+
+
+void TsPhaseSpaceToolkit::ReadHeader(const G4String& fileName, TsPhaseSpaceDecoder& decoder, G4long& numberOfHistories)
+{
+	G4String headerFileSpec = fileName + ".header";
+	std::ifstream headerFile(headerFileSpec);
+	if (!headerFile) {
+		G4cerr << "Error opening phase space header file:" << headerFileSpec << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	decoder.fLimitedAssumePhotonIsNewHistory = fLimitedAssumePhotonIsNewHistory;
+	decoder.fLimitedAssumeEveryParticleIsNewHistory = fLimitedAssumeEveryParticleIsNewHistory;
+	decoder.fLimitedAssumeFirstParticleIsNewHistory = fLimitedAssumeFirstParticleIsNewHistory;
+
+	// Limited format is recognized by its tags, as in the phase space source
+	G4bool hasTag1 = false;
+	G4bool hasTag2 = false;
+	G4bool hasTag3 = false;
+	G4String aLine;
+	while (headerFile.good()) {
+		getline(headerFile,aLine);
+
+		if (aLine.find("$RECORD_LENGTH:")!=std::string::npos) {
+			getline(headerFile,aLine);
+			std::istringstream input(aLine);
+			input >> decoder.fRecordLength;
+			hasTag1 = true;
+		}
+
+		if (aLine.find("$ORIG_HISTORIES:")!=std::string::npos) {
+			getline(headerFile,aLine);
+			std::istringstream input(aLine);
+			input >> numberOfHistories;
+			hasTag2 = true;
+		}
+
+		if (aLine.find("$PARTICLES:")!=std::string::npos) {
+			getline(headerFile,aLine);
+			hasTag3 = true;
+		}
+
+		if (aLine.find("Z is stored")!=std::string::npos && aLine.find("0")!=std::string::npos)
+			decoder.fLimitedHasZ = false;
+
+		if (aLine.find("Weight is stored")!=std::string::npos && aLine.find("0")!=std::string::npos)
+			decoder.fLimitedHasWeight = false;
+	}
+	headerFile.close();
+
+	if (hasTag1 && hasTag2 && hasTag3) {
+		decoder.fFormat = TsPhaseSpaceDecoder::LIMITED;
+	} else {
+		headerFile.open(headerFileSpec);
+
+		getline(headerFile,aLine);
+		if (aLine == "TOPAS Binary Phase Space") {
+			decoder.fFormat = TsPhaseSpaceDecoder::BINARY;
+		} else if (aLine == "TOPAS ASCII Phase Space") {
+			decoder.fFormat = TsPhaseSpaceDecoder::ASCII;
+		} else {
+			G4cerr << "Topas is exiting due to a serious error in phase space processing." << G4endl;
+			G4cerr << "Phase Space header file: " << headerFileSpec << " is either empty or has unrecognized form." << G4endl;
+			fPm->AbortSession(1);
+		}
+
+		getline(headerFile,aLine);
+		getline(headerFile,aLine);
+		if (aLine.substr(0,29) != "Number of Original Histories:") {
+			G4cerr << "Topas is exiting due to a serious error in phase space processing." << G4endl;
+			G4cerr << "Third line of header: " << headerFileSpec << " should start with \"Number of Original Histories:\"" << G4endl;
+			fPm->AbortSession(1);
+		}
+		std::istringstream input(aLine.substr(29));
+		input >> numberOfHistories;
+
+		getline(headerFile,aLine);
+		getline(headerFile,aLine);
+		if (decoder.fFormat == TsPhaseSpaceDecoder::BINARY) {
+			getline(headerFile,aLine);
+			if (aLine.substr(0,29) != "Number of Bytes per Particle:") {
+				G4cerr << "Topas is exiting due to a serious error in phase space processing." << G4endl;
+				G4cerr << "Sixth line of header: " << headerFileSpec << " should start with \"Number of Bytes per Particle:\"" << G4endl;
+				fPm->AbortSession(1);
+			}
+			std::istringstream input2(aLine.substr(29));
+			input2 >> decoder.fRecordLength;
+		}
+		headerFile.close();
+	}
+
+	if (decoder.IsFixedLength() && decoder.fRecordLength < decoder.GetMinimumRecordLength()) {
+		G4cerr << "Topas is exiting due to a serious error in phase space processing." << G4endl;
+		G4cerr << "Phase Space header: " << headerFileSpec << " gives a record length of " << decoder.fRecordLength << " bytes," << G4endl;
+		G4cerr << "but the columns stored in this format need at least " << decoder.GetMinimumRecordLength() << " bytes." << G4endl;
+		fPm->AbortSession(1);
+	}
+}
+
+
+void TsPhaseSpaceToolkit::ProcessInput(const G4String& fileName)
+{
+	TsPhaseSpaceDecoder decoder;
+	G4long headerNumberOfHistories = 0;
+	ReadHeader(fileName, decoder, headerNumberOfHistories);
+	fHeaderNumberOfHistories += headerNumberOfHistories;
+
+	G4String dataFileSpec = fileName + ".phsp";
+	G4long endOfData = TsPhaseSpaceIndex::GetEndOfData(dataFileSpec, decoder);
+
+	// Disk reads run ahead on a background thread while records are decoded and written here
+	TsPhaseSpacePrefetchBuffer prefetchBuffer(dataFileSpec, 0, fPrefetchBlockSize * 1024, fPrefetchDepth);
+	if (!prefetchBuffer.IsOpen()) {
+		G4cerr << "Error opening phase space data file:" << dataFileSpec << G4endl;
+		fPm->AbortSession(1);
+	}
+	std::istream dataStream(&prefetchBuffer);
+
+	G4cout << "Processing phase space: " << fileName << G4endl;
+
+	fInHistory = false;
+	TsPhaseSpaceRecord record;
+	G4long position = 0;
+
+	if (decoder.IsFixedLength()) {
+		std::vector<char> recordBuffer(decoder.fRecordLength);
+		while (position + decoder.fRecordLength <= endOfData) {
+			dataStream.read(recordBuffer.data(), decoder.fRecordLength);
+			if (!dataStream.good()) {
+				G4cerr << "Error reading phase space data file:" << dataFileSpec << " at position: " << position << G4endl;
+				fPm->AbortSession(1);
+			}
+			decoder.DecodeRecord(recordBuffer.data(), record);
+
+			if (decoder.fFormat == TsPhaseSpaceDecoder::LIMITED) {
+				if (position == 0 && fLimitedAssumeFirstParticleIsNewHistory)
+					record.isNewHistory = true;
+				record.particleCode = TsPhaseSpaceDecoder::LimitedCodeToPDG(record.particleCode);
+			}
+
+			ProcessRecord(record);
+			position += decoder.fRecordLength;
+		}
+	} else {
+		std::string line;
+		while (position < endOfData && getline(dataStream, line)) {
+			if (!decoder.DecodeLine(line.data(), line.data() + line.size(), record)) {
+				G4cerr << "Error reading phase space file:" << dataFileSpec << G4endl;
+				G4cerr << "A line does not hold the ten columns expected in TOPAS ASCII format:" << G4endl;
+				G4cerr << line << G4endl;
+				fPm->AbortSession(1);
+			}
+
+			ProcessRecord(record);
+			position += line.size() + 1;
+		}
+	}
+}
+
+
+void TsPhaseSpaceToolkit::ProcessRecord(TsPhaseSpaceRecord& record)
+{
+	if (record.isNewHistory) {
+		// A negative weight marks an empty history. Less than -1 stands for several.
+		if (record.weight < 0.) {
+			G4long numberOfHistories = (record.weight < -1.) ? G4long(std::ceil(-record.weight)) : 1;
+			fInputStatistics.histories += numberOfHistories;
+			fInHistory = false;
+			WriteEmptyHistories(numberOfHistories);
+			return;
+		}
+
+		fInputStatistics.histories++;
+		fInputStatistics.nonEmptyHistories++;
+		fInHistory = true;
+		fHistoryHasOutput = false;
+		StartHistories(1);
+	} else if (!fInHistory) {
+		G4cerr << "Topas is exiting due to a serious error in phase space processing." << G4endl;
+		G4cerr << "Found a particle that is not marked as the start of a new history," << G4endl;
+		G4cerr << "but it does not follow any particle of a non-empty history." << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	if (record.particleCode == 0) {
+		fNumberOfUnsupportedParticles++;
+		return;
+	}
+
+	fInputStatistics.AddParticle(record);
+
+	if (PassesFilter(record) && WriteParticle(record, !fHistoryHasOutput))
+		fHistoryHasOutput = true;
+}
+
+
+G4bool TsPhaseSpaceToolkit::PassesFilter(const TsPhaseSpaceRecord& record) const
+{
+	if (fFilterByParticle && fKeepParticles.find(record.particleCode) == fKeepParticles.end())
+		return false;
+
+	G4double energy = record.kEnergy * MeV;
+	return energy >= fMinimumEnergy && energy <= fMaximumEnergy;
+}
+
+
+void TsPhaseSpaceToolkit::StartHistories(G4long numberOfHistories)
+{
+	if (!fNtuple)
+		return;
+
+	if (fHistoriesPerFile > 0 && fPartHistories >= fHistoriesPerFile) {
+		CloseOutput(0);
+		OpenOutput();
+	}
+
+	fPartHistories += numberOfHistories;
+	fPartStatistics.histories += numberOfHistories;
+}
+
+
+G4bool TsPhaseSpaceToolkit::WriteParticle(const TsPhaseSpaceRecord& record, G4bool isNewHistory)
+{
+	if (!fNtuple)
+		return true;
+
+	if (fOutputType == "limited") {
+		G4int limitedCode = TsPhaseSpaceDecoder::PDGToLimitedCode(record.particleCode);
+		if (limitedCode == 0) {
+			fNumberOfUnsupportedParticles++;
+			return false;
+		}
+		fSignedPType = record.cosZIsNegative ? -limitedCode : limitedCode;
+		fSignedEnergy = isNewHistory ? -record.kEnergy : record.kEnergy;
+	}
+
+	fPosX = record.posX;
+	fPosY = record.posY;
+	fPosZ = record.posZ;
+	fCosX = record.dCos1;
+	fCosY = record.dCos2;
+	fEnergy = record.kEnergy;
+	fWeight = record.weight;
+	fPType = record.particleCode;
+	fCosZIsNegative = record.cosZIsNegative;
+	fIsNewHistory = isNewHistory;
+	fNtuple->Fill();
+
+	fPartStatistics.AddParticle(record);
+	if (isNewHistory)
+		fPartStatistics.nonEmptyHistories++;
+	return true;
+}
+
+
+void TsPhaseSpaceToolkit::WriteEmptyHistories(G4long numberOfHistories)
+{
+	if (!fNtuple)
+		return;
+
+	while (numberOfHistories > 0) {
+		if (fHistoriesPerFile > 0 && fPartHistories >= fHistoriesPerFile) {
+			CloseOutput(0);
+			OpenOutput();
+		}
+
+		// Keep runs of empty histories in one record, unless they straddle two output files
+		G4long numberInThisFile = numberOfHistories;
+		if (fHistoriesPerFile > 0 && numberInThisFile > fHistoriesPerFile - fPartHistories)
+			numberInThisFile = fHistoriesPerFile - fPartHistories;
+
+		fPartHistories += numberInThisFile;
+		fPartStatistics.histories += numberInThisFile;
+		numberOfHistories -= numberInThisFile;
+
+		// Limited format has no way to store an empty history in sequence, so its header count covers them
+		if (fOutputType != "limited") {
+			fPosX = 0.;
+			fPosY = 0.;
+			fPosZ = 0.;
+			fCosX = 0.;
+			fCosY = 0.;
+			fEnergy = 0.;
+			fWeight = -numberInThisFile;
+			fPType = 0;
+			fCosZIsNegative = false;
+			fIsNewHistory = true;
+			fNtuple->Fill();
+		}
+	}
+}
+
+
+void TsPhaseSpaceToolkit::OpenOutput()
+{
+	fPartNumber++;
+	G4String fileName = fOutputFile;
+	if (fHistoriesPerFile > 0)
+		fileName += "_" + G4UIcommand::ConvertToString(fPartNumber);
+
+	if (fOutputType == "ascii")
+		fNtuple = new TsNtupleAscii(fPm, fileName, fIfOutputFileAlreadyExists, 0);
+	else
+		fNtuple = new TsNtupleBinary(fPm, fileName, fIfOutputFileAlreadyExists, 0);
+	fNtuple->SetBufferSize(fBufferSize);
+
+	// Units are part of the column names, so that values are copied exactly as read
+	if (fOutputType == "limited") {
+		fNtuple->RegisterColumnI8(&fSignedPType, "Particle Type (sign from z direction)");
+		fNtuple->RegisterColumnF(&fSignedEnergy, "Energy (-ve if new history) [MeV]", "");
+		fNtuple->RegisterColumnF(&fPosX, "Position X [cm]", "");
+		fNtuple->RegisterColumnF(&fPosY, "Position Y [cm]", "");
+		fNtuple->RegisterColumnF(&fPosZ, "Position Z [cm]", "");
+		fNtuple->RegisterColumnF(&fCosX, "Direction Cosine X", "");
+		fNtuple->RegisterColumnF(&fCosY, "Direction Cosine Y", "");
+		fNtuple->RegisterColumnF(&fWeight, "Weight", "");
+	} else {
+		fNtuple->RegisterColumnF(&fPosX, "Position X [cm]", "");
+		fNtuple->RegisterColumnF(&fPosY, "Position Y [cm]", "");
+		fNtuple->RegisterColumnF(&fPosZ, "Position Z [cm]", "");
+		fNtuple->RegisterColumnF(&fCosX, "Direction Cosine X", "");
+		fNtuple->RegisterColumnF(&fCosY, "Direction Cosine Y", "");
+		fNtuple->RegisterColumnF(&fEnergy, "Energy [MeV]", "");
+		fNtuple->RegisterColumnF(&fWeight, "Weight", "");
+		fNtuple->RegisterColumnI(&fPType, "Particle Type (in PDG Format)");
+		fNtuple->RegisterColumnB(&fCosZIsNegative, "Flag to tell if Third Direction Cosine is Negative (1 means true)");
+		fNtuple->RegisterColumnB(&fIsNewHistory, "Flag to tell if this is the First Scored Particle from this History (1 means true)");
+	}
+
+	fPartHistories = 0;
+	fPartStatistics = Statistics();
+}
+
+
+void TsPhaseSpaceToolkit::CloseOutput(G4long additionalEmptyHistories)
+{
+	G4long originalHistories = fPartStatistics.histories + additionalEmptyHistories;
+
+	if (fOutputType == "limited") {
+		std::ostringstream header;
+
+		header << "$TITLE:" << G4endl;
+		header << "TOPAS Phase Space in \"limited\" format. " <<
+		"Should only be used when it is necessary to read or write from restrictive older codes." << G4endl;
+
+		header << "$RECORD_CONTENTS:" << G4endl;
+		header << "    1     // X is stored ?" << G4endl;
+		header << "    1     // Y is stored ?" << G4endl;
+		header << "    1     // Z is stored ?" << G4endl;
+		header << "    1     // U is stored ?" << G4endl;
+		header << "    1     // V is stored ?" << G4endl;
+		header << "    1     // W is stored ?" << G4endl;
+		header << "    1     // Weight is stored ?" << G4endl;
+		header << "    0     // Extra floats stored ?" << G4endl;
+		header << "    0     // Extra longs stored ?" << G4endl;
+
+		header << "$RECORD_LENGTH:" << G4endl;
+		header << 7*sizeof(G4float) + 1 << G4endl;
+
+		header << "$ORIG_HISTORIES:" << G4endl;
+		header << originalHistories << G4endl;
+
+		header << "$PARTICLES:" << G4endl;
+		header << fPartStatistics.particles << G4endl;
+
+		header << "$EXTRA_FLOATS:" << G4endl;
+		header << "0" << G4endl;
+
+		header << "$EXTRA_INTS:" << G4endl;
+		header << "0" << G4endl;
+
+		fNtuple->fHeaderPrefix = header.str();
+		fNtuple->SuppressColumnDescription(true);
+	} else {
+		std::ostringstream title;
+		if (fOutputType == "ascii")
+			title << "TOPAS ASCII Phase Space" << G4endl << G4endl;
+		else
+			title << "TOPAS Binary Phase Space" << G4endl << G4endl;
+
+		fNtuple->fHeaderPrefix = title.str() + DescribeHistories(fPartStatistics, originalHistories);
+		fNtuple->fHeaderSuffix = DescribeParticles(fPartStatistics);
+	}
+
+	fNtuple->Write();
+
+	G4cout << "Header   has been written to file: " << fNtuple->GetHeaderFileName() << G4endl;
+	G4cout << "Contents has been written to file: " << fNtuple->GetDataFileName() << G4endl;
+
+	fOutputStatistics.histories += originalHistories;
+	fOutputStatistics.nonEmptyHistories += fPartStatistics.nonEmptyHistories;
+	fOutputStatistics.particles += fPartStatistics.particles;
+
+	delete fNtuple;
+	fNtuple = 0;
+}
+
+
+G4String TsPhaseSpaceToolkit::DescribeHistories(const Statistics& statistics, G4long originalHistories) const
+{
+	std::ostringstream description;
+	description << "Number of Original Histories: " << originalHistories << G4endl;
+	description << "Number of Original Histories that Reached Phase Space: " << statistics.nonEmptyHistories << G4endl;
+	description << "Number of Scored Particles: " << statistics.particles << G4endl;
+	return description.str();
+}
+
+
+G4String TsPhaseSpaceToolkit::DescribeParticles(const Statistics& statistics) const
+{
+	std::ostringstream description;
+	std::map<G4int, G4long>::const_iterator itr;
+	for (itr = statistics.numberOfParticles.begin(); itr != statistics.numberOfParticles.end(); ++itr)
+		description << "Number of " << GetParticleName(itr->first) << ": " << itr->second << G4endl;
+	description << std::endl;
+
+	std::map<G4int, G4double>::const_iterator itr_d;
+	for (itr_d = statistics.minimumKE.begin(); itr_d != statistics.minimumKE.end(); ++itr_d)
+		description << "Minimum Kinetic Energy of " << GetParticleName(itr_d->first) << ": " << itr_d->second << " MeV" << G4endl;
+	description << std::endl;
+
+	for (itr_d = statistics.maximumKE.begin(); itr_d != statistics.maximumKE.end(); ++itr_d)
+		description << "Maximum Kinetic Energy of " << GetParticleName(itr_d->first) << ": " << itr_d->second << " MeV" << G4endl;
+
+	return description.str();
+}
+
+
+G4String TsPhaseSpaceToolkit::GetParticleName(G4int pdgCode) const
+{
+	G4ParticleDefinition* particle = G4ParticleTable::GetParticleTable()->FindParticle(pdgCode);
+	if (particle)
+		return particle->GetParticleName();
+	return "particles with PDG code " + G4UIcommand::ConvertToString(pdgCode);
+}
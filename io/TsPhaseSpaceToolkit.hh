@@ -0,0 +1,139 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#ifndef TsPhaseSpaceToolkit_hh
+#define TsPhaseSpaceToolkit_hh
+
+#include "TsPhaseSpaceDecoder.hh"
+
+#include "globals.hh"
+
+#include <map>
+#include <set>
+#include <vector>
+#include <stdint.h>
+
+class TsParameterManager;
+class TsVNtuple;
+
+// Stream processing of existing phase space files without a simulation.
+// One or more input phase spaces (any TOPAS format) are read in turn, optionally filtered by
+// particle type and energy, and written to one output phase space or split into several,
+// with headers recomputed from the particles actually written. Without an output file,
+// the inputs are only summarized.
+class TsPhaseSpaceToolkit
+{
+public:
+	TsPhaseSpaceToolkit(TsParameterManager* pM);
+	~TsPhaseSpaceToolkit();
+
+	void Run();
+
+private:
+	struct Statistics
+	{
+		Statistics();
+		void AddParticle(const TsPhaseSpaceRecord& record);
+
+		G4long histories;
+		G4long nonEmptyHistories;
+		G4long particles;
+		std::map<G4int, G4long> numberOfParticles;
+		std::map<G4int, G4double> minimumKE;
+		std::map<G4int, G4double> maximumKE;
+	};
+
+	void ReadHeader(const G4String& fileName, TsPhaseSpaceDecoder& decoder, G4long& numberOfHistories);
+	void ProcessInput(const G4String& fileName);
+	void ProcessRecord(TsPhaseSpaceRecord& record);
+	G4bool PassesFilter(const TsPhaseSpaceRecord& record) const;
+
+	void StartHistories(G4long numberOfHistories);
+	G4bool WriteParticle(const TsPhaseSpaceRecord& record, G4bool isNewHistory);
+	void WriteEmptyHistories(G4long numberOfHistories);
+	void OpenOutput();
+	void CloseOutput(G4long additionalEmptyHistories);
+
+	G4String DescribeHistories(const Statistics& statistics, G4long originalHistories) const;
+	G4String DescribeParticles(const Statistics& statistics) const;
+	G4String GetParticleName(G4int pdgCode) const;
+
+	TsParameterManager* fPm;
+
+	std::vector<G4String> fInputFiles;
+	G4String fOutputFile;
+	G4String fOutputType;
+	G4String fIfOutputFileAlreadyExists;
+	G4long fHistoriesPerFile;
+	G4int fBufferSize;
+	G4int fPrefetchDepth;
+	G4long fPrefetchBlockSize;
+
+	G4bool fFilterByParticle;
+	std::set<G4int> fKeepParticles;
+	G4double fMinimumEnergy;
+	G4double fMaximumEnergy;
+
+	G4bool fLimitedAssumePhotonIsNewHistory;
+	G4bool fLimitedAssumeEveryParticleIsNewHistory;
+	G4bool fLimitedAssumeFirstParticleIsNewHistory;
+
+	// State of the input being read
+	G4bool fInHistory;
+	G4bool fHistoryHasOutput;
+	G4long fNumberOfUnsupportedParticles;
+
+	// State of the output part being written
+	TsVNtuple* fNtuple;
+	G4int fPartNumber;
+	G4long fPartHistories;
+	Statistics fPartStatistics;
+
+	Statistics fInputStatistics;
+	Statistics fOutputStatistics;
+	G4long fHeaderNumberOfHistories;
+
+	// Column values for the output ntuple
+	G4float fPosX;
+	G4float fPosY;
+	G4float fPosZ;
+	G4float fCosX;
+	G4float fCosY;
+	G4float fEnergy;
+	G4float fWeight;
+	G4int fPType;
+	G4bool fCosZIsNegative;
+	G4bool fIsNewHistory;
+	G4float fSignedEnergy;
+	int8_t fSignedPType;
+};
+
+#endif
@@ -40,7 +40,7 @@ class TsVFile
 {
 public:
 	TsVFile(TsParameterManager* pM, G4String fileName, G4String mode, TsVFile *masterFile);
-	~TsVFile();
+	virtual ~TsVFile();
 
 	virtual void SetFileName(G4String newBaseFileName);
 
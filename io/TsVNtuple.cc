@@ -148,13 +148,14 @@ void TsVNtuple::Fill()
 		if (G4Threading::IsWorkerThread()) {
 			TsVNtuple* masterNtuple = dynamic_cast<TsVNtuple*>(fMasterFile);
 			masterNtuple->AbsorbWorkerNtuple(this);
+			return;
 		}
-#else
+#endif
+		// Ntuples filled directly on the master (or without MT) write out their own full buffer
 		ConfirmCanOpen();
 		WriteBuffer();
 		ClearBuffer();
 		fNumberOfBufferEntries = 0;
-#endif
 	}
 }
 
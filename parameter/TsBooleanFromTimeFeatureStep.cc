@@ -47,8 +47,6 @@ TsBooleanFromTimeFeatureStep::TsBooleanFromTimeFeatureStep(TsParameterManager* p
 	} else {
 		fCurrentValue = false;
 	}
-	fRange    = 0;
-	fTimes    = new std::map<G4double, G4int>;
 }
 
 
@@ -67,10 +65,9 @@ G4bool TsBooleanFromTimeFeatureStep::GetBooleanValue()
 {
 	fUsed = true;
 	G4double t = fPm->GetCurrentSequenceTime();
-	while(t >= fRange ) { t -= fRange; }
+	t = fTimes.WrapTime(t);
 	if (t == fLatestUpdatedTime) { return fCurrentValue;}
-	std::map<G4double, G4int>::const_iterator pos = fTimes->upper_bound(t);
-	G4int idx = pos->second;
+	G4int idx = fTimes.GetIndex(t);
 	if ( fValuesIfParameterNames[idx] == "" ) {
 		return fValues[idx];
 	} else {
@@ -99,10 +96,7 @@ void TsBooleanFromTimeFeatureStep::InitializeTimeFeatureValue() {
 	}
 
 	G4double* times = fPm->GetDoubleVector(fNameOfBaseParameter+"/Times", "Time");
-	fRange = times[ntimes-1];
-	for (int i=0; i < ntimes; ++i) {
-		fTimes->insert(std::make_pair(times[i],i));
-	}
+	fTimes.Fill(ntimes, times);
 }
 
 G4bool TsBooleanFromTimeFeatureStep::ValueHasChanged() {
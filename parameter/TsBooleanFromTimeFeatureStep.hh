@@ -32,8 +32,7 @@
 #define TsBooleanFromTimeFeatureStep_hh
 
 #include "TsVParameter.hh"
-
-#include <map>
+#include "TsTimeFeatureStepTable.hh"
 
 class TsBooleanFromTimeFeatureStep : public TsVParameter
 {
@@ -56,8 +55,7 @@ private:
 
 	G4bool* fValues;
 	G4String* fValuesIfParameterNames;
-	std::map<G4double, G4int>* fTimes;
-	G4double fRange;
+	TsTimeFeatureStepTable fTimes;
 };
 
 #endif
@@ -50,6 +50,7 @@ void TsDefaultParameters::SetDefaults(TsParameterFile* file)
 	file->AddTempParameter("b:Ts/DumpParameters", "\"False\"");
 	file->AddTempParameter("b:Ts/DumpNonDefaultParameters", "\"False\"");
 	file->AddTempParameter("b:Ts/ListUnusedParameters", "\"False\"");
+	file->AddTempParameter("b:Ts/CheckFlattenedParameterTable", "\"False\"");
 	file->AddTempParameter("b:Ts/LimitConsoleToOneThread", "\"False\"");
 	file->AddTempParameter("i:Ts/ShowHistoryCountAtInterval", "1");
 	file->AddTempParameter("i:Ts/MaxShowHistoryCountInterval", "2147483647");
@@ -103,10 +104,13 @@ void TsDefaultParameters::SetDefaults(TsParameterFile* file)
 	file->AddTempParameter("d:Ph/Default/EMRangeMax", "600. MeV");
 
 	file->AddTempParameter("b:Tf/RandomizeTimeDistribution", "\"False\"");
+	file->AddTempParameter("b:Tf/RandomizeTimePerEvent", "\"False\"");
+	file->AddTempParameter("b:Tf/MergeSequentialTimes", "\"False\"");
 	file->AddTempParameter("d:Tf/TimelineStart", "0. s");
 	file->AddTempParameter("d:Tf/TimelineEnd", "Tf/TimelineStart s");
 	file->AddTempParameter("i:Tf/NumberOfSequentialTimes", "1");
 	file->AddTempParameter("i:Tf/Verbosity", "0");
+	file->AddTempParameter("b:Tf/ReportUpdatesForEachRun", "\"False\"");
 
 	file->AddTempParameter("i:Ge/Verbosity", "0");
 	file->AddTempParameter("b:Ge/CheckForOverlaps", "\"True\"");
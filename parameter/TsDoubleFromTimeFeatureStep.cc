@@ -45,8 +45,6 @@ TsDoubleFromTimeFeatureStep::TsDoubleFromTimeFeatureStep(TsParameterManager* pM,
 	ConvertToDoubleVector(nValues, values, fValues, fValuesIfParameterNames);
 	G4String initvalue = tempParameter->GetValue();
 	fCurrentValue = (G4UIcommand::ConvertToDouble(initvalue)) * fPm->GetUnitValue(fUnit);
-	fRange = 0;
-	fTimes = new std::map<G4double, G4int>;
 }
 
 
@@ -70,10 +68,9 @@ G4double TsDoubleFromTimeFeatureStep::GetDoubleValue()
 {
 	fUsed = true;
 	G4double t = fPm->GetCurrentSequenceTime();
-	while(t >= fRange ) { t -= fRange; }
+	t = fTimes.WrapTime(t);
 	if (t == fLatestUpdatedTime) { return fCurrentValue;}
-	std::map<G4double, G4int>::const_iterator pos = fTimes->upper_bound(t);
-	G4int idx = pos->second;
+	G4int idx = fTimes.GetIndex(t);
 	if ( fValuesIfParameterNames[idx] =="" ) {
 		return fValues[idx]*fPm->GetUnitValue(fUnit);
 	} else {
@@ -97,10 +94,7 @@ void TsDoubleFromTimeFeatureStep::InitializeTimeFeatureValue() {
 	}
 
 	G4double* times = fPm->GetDoubleVector(fNameOfBaseParameter+"/Times", "Time");
-	fRange = times[ntimes-1];
-	for (int i=0; i < ntimes; ++i) {
-		fTimes->insert(std::make_pair(times[i],i));
-	}
+	fTimes.Fill(ntimes, times);
 }
 
 G4bool TsDoubleFromTimeFeatureStep::ValueHasChanged() {
@@ -32,8 +32,7 @@
 #define TsDoubleFromTimeFeatureStep_hh
 
 #include "TsVParameter.hh"
-
-#include <map>
+#include "TsTimeFeatureStepTable.hh"
 
 class TsDoubleFromTimeFeatureStep : public TsVParameter
 {
@@ -58,8 +57,7 @@ private:
 
 	G4double* fValues;
 	G4String* fValuesIfParameterNames;
-	std::map<G4double, G4int>* fTimes;
-	G4double fRange;
+	TsTimeFeatureStepTable fTimes;
 };
 
 #endif
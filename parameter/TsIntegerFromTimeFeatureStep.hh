@@ -32,8 +32,7 @@
 #define TsIntegerFromTimeFeatureStep_hh
 
 #include "TsVParameter.hh"
-
-#include <map>
+#include "TsTimeFeatureStepTable.hh"
 
 class TsIntegerFromTimeFeatureStep : public TsVParameter
 {
@@ -56,8 +55,7 @@ private:
 
 	G4int* fValues;
 	G4String* fValuesIfParameterNames;
-	std::map<G4double, G4int>* fTimes;
-	G4double fRange;
+	TsTimeFeatureStepTable fTimes;
 };
 
 #endif
@@ -179,7 +179,10 @@ TsParameterFile::TsParameterFile(TsParameterManager* pM, const G4String& fileSpe
 	fIncludeFiles = new std::vector<TsParameterFile*>;
 	fTempParameters = new std::map<G4String,TsTempParameter*>;
 	fRealParameters = new std::map<G4String,TsVParameter*>;
+	fFlattenedParameters = 0;
 	fTimeFeatureParameters = new std::vector<TsVParameter*>;
+	fSavedRealParameters = 0;
+	fSavedTimeFeatureParameters = 0;
 	// The transient parameter "file" has no actual file to read in, and its parent is the user's specified top file
 	if (fFileSpec == "TransientParameters") {
 		fTransientFile = this;
@@ -187,30 +190,34 @@ TsParameterFile::TsParameterFile(TsParameterManager* pM, const G4String& fileSpe
 	} else if (fFileSpec == fDefaultFileSpec) {
 		TsDefaultParameters::SetDefaults(this);
 	} else {
-		std::ifstream infile(fileSpec);
-		if (!infile) {
-			if (fileSpec == "TsUserParameters.txt") {
-				G4cerr << "Topas quitting. Unable to find top level parameter file." << G4endl;
-				G4cerr << "Specify the top level parameter file on the command line," << G4endl;
-				G4cerr << "or provide a file named TsUserParameters.txt." << G4endl;
+		std::vector<G4String>* names = new std::vector<G4String>;
+		std::vector<G4String>* values = new std::vector<G4String>;
+
+		// The file may already have been parsed on a worker thread
+		if (!fPm->TakePreParsedFile(fileSpec, names, values)) {
+			std::ifstream infile(fileSpec);
+			if (!infile) {
+				if (fileSpec == "TsUserParameters.txt") {
+					G4cerr << "Topas quitting. Unable to find top level parameter file." << G4endl;
+					G4cerr << "Specify the top level parameter file on the command line," << G4endl;
+					G4cerr << "or provide a file named TsUserParameters.txt." << G4endl;
+				} else {
+					G4cerr << "Topas quitting, unable to open parameter file:" << fileSpec << G4endl;
+				}
+				fPm->AbortSession(1);
 			} else {
-				G4cerr << "Topas quitting, unable to open parameter file:" << fileSpec << G4endl;
-			}
-			fPm->AbortSession(1);
-		} else {
-			std::vector<G4String>* names = new std::vector<G4String>;
-			std::vector<G4String>* values = new std::vector<G4String>;
-			fPm->ReadFile(fileSpec, infile, names, values);
-
-			G4int length = names->size();
-			for (G4int iToken=0; iToken<length; iToken++) {
-				G4String name = (*names)[iToken];
-				G4String value = (*values)[iToken];
-				AddTempParameter(name, value);
+				fPm->ReadFile(fileSpec, infile, names, values);
 			}
-			delete names;
-			delete values;
 		}
+
+		G4int length = names->size();
+		for (G4int iToken=0; iToken<length; iToken++) {
+			G4String name = (*names)[iToken];
+			G4String value = (*values)[iToken];
+			AddTempParameter(name, value);
+		}
+		delete names;
+		delete values;
 	}
 
 	// If there are no include files and this is not the default file, include the default file
@@ -248,6 +255,9 @@ TsParameterFile::~TsParameterFile()
 {
 	delete fTempParameters;
 	delete fRealParameters;
+	delete fFlattenedParameters;
+	delete fSavedRealParameters;
+	delete fSavedTimeFeatureParameters;
 }
 
 
@@ -582,7 +592,7 @@ void TsParameterFile::ProcessTempParameters(G4bool test) {
 
 			if ( tf_parameter != 0) {
 				fTimeFeatureParameters->push_back(tf_parameter);
-				(*fRealParameters)[param_name] = tf_parameter;
+				StoreRealParameter(param_name, tf_parameter);
 			}
 		}
 	}
@@ -1520,13 +1530,22 @@ void TsParameterFile::ProcessTempParameters(G4bool test) {
 
 		// Parameter is ready to store
 		if (!test)
-			(*fRealParameters)[iter->first] = parameter;
+			StoreRealParameter(iter->first, parameter);
 	}
 
 	fTempParameters->clear();
 }
 
 
+// A parameter stored in the file that owns the flattened table sits at the top of the chain, so it always wins.
+void TsParameterFile::StoreRealParameter(const G4String& nameInLower, TsVParameter* parameter)
+{
+	(*fRealParameters)[nameInLower] = parameter;
+	if (fFlattenedParameters)
+		(*fFlattenedParameters)[nameInLower] = parameter;
+}
+
+
 void TsParameterFile::ProtectAgainstControlByDifferentArms(G4String paramName, TsParameterFile* includeFile1, G4String prefix, G4String suffix) {
 	if (paramName.substr(0,prefix.length()) == prefix && paramName.substr(paramName.length()-suffix.length()) == suffix) {
 		std::vector<TsParameterFile*>::iterator includeFileIter2;
@@ -1570,36 +1589,106 @@ void TsParameterFile::ProtectAgainstControlByDifferentArms(G4String paramName, T
 
 
 G4bool TsParameterFile::ParameterExists(const G4String& s)
+{
+	return GetParameter(s) != 0;
+}
+
+
+// Once the flattened table has been built, it holds the winning definition of every name in the chain.
+// Until then, and in every file other than the one that owns the table, walk the chain.
+TsVParameter* TsParameterFile::GetParameter(const G4String& s)
 {
 	G4String sLower = s;
 	G4StrUtil::to_lower(sLower);
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter == fRealParameters->end()) {
+	if (fFlattenedParameters) {
+		std::unordered_map<std::string, TsVParameter*>::const_iterator iter = fFlattenedParameters->find(sLower);
+		if (iter == fFlattenedParameters->end())
+			return 0;
+		return iter->second;
+	}
 
-		if (fParentFile)
-			return fParentFile->ParameterExists(s);
-		else
-			return false;
+	return GetParameterFromChain(sLower);
+}
+
+
+TsVParameter* TsParameterFile::GetParameterFromChain(const G4String& sLower)
+{
+	for (TsParameterFile* file = this; file; file = file->fParentFile) {
+		std::map<G4String, TsVParameter*>::const_iterator iter = file->fRealParameters->find(sLower);
+		if (iter != file->fRealParameters->end())
+			return iter->second;
 	}
-	return true;
+	return 0;
 }
 
 
-TsVParameter* TsParameterFile::GetParameter(const G4String& s)
+void TsParameterFile::BuildFlattenedParameterTable()
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
+	delete fFlattenedParameters;
+	fFlattenedParameters = new std::unordered_map<std::string, TsVParameter*>;
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter == fRealParameters->end()) {
+	// Files nearer the top of the chain override those further down, so keep the first definition of each name.
+	for (TsParameterFile* file = this; file; file = file->fParentFile)
+		fFlattenedParameters->insert(file->fRealParameters->begin(), file->fRealParameters->end());
+}
 
-		if (fParentFile)
-			return fParentFile->GetParameter(s);
-		else
-			return 0;
+
+// Parameters replaced after the snapshot are left allocated, since time feature stores and handles may still refer to them.
+void TsParameterFile::SaveParameters()
+{
+	delete fSavedRealParameters;
+	delete fSavedTimeFeatureParameters;
+	fSavedRealParameters = new std::map<G4String,TsVParameter*>(*fRealParameters);
+	fSavedTimeFeatureParameters = new std::vector<TsVParameter*>(*fTimeFeatureParameters);
+}
+
+
+void TsParameterFile::RestoreSavedParameters()
+{
+	if (!fSavedRealParameters)
+		return;
+
+	*fRealParameters = *fSavedRealParameters;
+	*fTimeFeatureParameters = *fSavedTimeFeatureParameters;
+
+	if (fFlattenedParameters)
+		BuildFlattenedParameterTable();
+}
+
+
+G4bool TsParameterFile::CheckFlattenedParameterTable()
+{
+	G4bool matches = true;
+	G4int nChecked = 0;
+
+	for (TsParameterFile* file = this; file; file = file->fParentFile) {
+		std::map<G4String, TsVParameter*>::const_iterator iter;
+		for (iter = file->fRealParameters->begin(); iter != file->fRealParameters->end(); ++iter) {
+			TsVParameter* fromTable = GetParameter(iter->first);
+			TsVParameter* fromChain = GetParameterFromChain(iter->first);
+			if (fromTable != fromChain) {
+				G4cerr << "Flattened parameter table disagrees with parameter file chain for: " << iter->first << G4endl;
+				G4cerr << "Table gives definition from: " << (fromTable ? fromTable->GetParameterFile()->GetFileName() : "nowhere") << G4endl;
+				G4cerr << "Chain gives definition from: " << (fromChain ? fromChain->GetParameterFile()->GetFileName() : "nowhere") << G4endl;
+				matches = false;
+			}
+			nChecked++;
+		}
 	}
-	return iter->second;
+
+	if (fFlattenedParameters) {
+		std::unordered_map<std::string, TsVParameter*>::const_iterator iter;
+		for (iter = fFlattenedParameters->begin(); iter != fFlattenedParameters->end(); ++iter) {
+			if (iter->second != GetParameterFromChain(iter->first)) {
+				G4cerr << "Flattened parameter table has a definition the parameter file chain does not give for: " << iter->first << G4endl;
+				matches = false;
+			}
+		}
+	}
+
+	G4cout << "Compared " << nChecked << " parameter definitions against the flattened parameter table." << G4endl;
+	return matches;
 }
 
 
@@ -1623,16 +1712,11 @@ TsVParameter* TsParameterFile::GetParameterBeforeLinearized(const G4String& s)
 
 G4int TsParameterFile::GetVectorLength(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4int nValues = 0;
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		nValues = parameter->GetVectorLength();
-	} else if (fParentFile)
-		nValues = fParentFile->GetVectorLength(s);
 	else
 		Undefined(s);
 
@@ -1642,16 +1726,11 @@ G4int TsParameterFile::GetVectorLength(const G4String& s)
 
 G4double TsParameterFile::GetDoubleParameter(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4double value = -99999999.;
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		value = parameter->GetDoubleValue();
-	} else if (fParentFile)
-		value = fParentFile->GetDoubleParameter(s);
 	else
 		Undefined(s);
 
@@ -1661,16 +1740,11 @@ G4double TsParameterFile::GetDoubleParameter(const G4String& s)
 
 G4double TsParameterFile::GetUnitlessParameter(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4double value = 99999999.;
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		value = parameter->GetUnitlessValue();
-	} else if (fParentFile)
-		value = fParentFile->GetUnitlessParameter(s);
 	else
 		Undefined(s);
 
@@ -1680,16 +1754,11 @@ G4double TsParameterFile::GetUnitlessParameter(const G4String& s)
 
 G4int TsParameterFile::GetIntegerParameter(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4int value = 99999999;
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		value = parameter->GetIntegerValue();
-	} else if (fParentFile)
-		value = fParentFile->GetIntegerParameter(s);
 	else
 		Undefined(s);
 
@@ -1699,16 +1768,11 @@ G4int TsParameterFile::GetIntegerParameter(const G4String& s)
 
 G4bool TsParameterFile::GetBooleanParameter(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4bool value = false;
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		value = parameter->GetBooleanValue();
-	} else if (fParentFile)
-		value = fParentFile->GetBooleanParameter(s);
 	else
 		Undefined(s);
 
@@ -1718,16 +1782,11 @@ G4bool TsParameterFile::GetBooleanParameter(const G4String& s)
 
 G4String TsParameterFile::GetStringParameter(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4String value = "invalid";
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		value = parameter->GetStringValue();
-	} else if (fParentFile)
-		value = fParentFile->GetStringParameter(s);
 	else
 		Undefined(s);
 
@@ -1737,17 +1796,12 @@ G4String TsParameterFile::GetStringParameter(const G4String& s)
 
 G4double* TsParameterFile::GetDoubleVector(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4double* value = new G4double[1];
 	value[0] = -9999999.;
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		value = parameter->GetDoubleVector();
-	} else if (fParentFile)
-		value = fParentFile->GetDoubleVector(s);
 	else
 		Undefined(s);
 
@@ -1757,17 +1811,12 @@ G4double* TsParameterFile::GetDoubleVector(const G4String& s)
 
 G4double* TsParameterFile::GetUnitlessVector(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4double* value = new G4double[1];
 	value[0] = -9999999.;
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		value = parameter->GetUnitlessVector();
-	} else if (fParentFile)
-		value = fParentFile->GetUnitlessVector(s);
 	else
 		Undefined(s);
 
@@ -1777,17 +1826,12 @@ G4double* TsParameterFile::GetUnitlessVector(const G4String& s)
 
 G4int* TsParameterFile::GetIntegerVector(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4int* value = new G4int[1];
 	value[0] = -9999999;
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		value = parameter->GetIntegerVector();
-	} else if (fParentFile)
-		value = fParentFile->GetIntegerVector(s);
 	else
 		Undefined(s);
 
@@ -1797,17 +1841,12 @@ G4int* TsParameterFile::GetIntegerVector(const G4String& s)
 
 G4bool* TsParameterFile::GetBooleanVector(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4bool* value = new G4bool[1];
 	value[0] = false;
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		value = parameter->GetBooleanVector();
-	} else if (fParentFile)
-		value = fParentFile->GetBooleanVector(s);
 	else
 		Undefined(s);
 
@@ -1817,17 +1856,12 @@ G4bool* TsParameterFile::GetBooleanVector(const G4String& s)
 
 G4String* TsParameterFile::GetStringVector(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
 	G4String* value = new G4String[1];
 	value[0] = "";
 
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end()) {
-		TsVParameter* parameter = iter->second;
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
 		value = parameter->GetStringVector();
-	} else if (fParentFile)
-		value = fParentFile->GetStringVector(s);
 	else
 		Undefined(s);
 
@@ -1855,11 +1889,9 @@ G4String TsParameterFile::GetTypeOfParameter(const G4String& s)
 	G4String sLower = s;
 	G4StrUtil::to_lower(sLower);
 	G4String type = "";
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter != fRealParameters->end())
-		type = iter->second->GetType();
-	else if (fParentFile)
-		type = fParentFile->GetTypeOfParameter(s);
+	TsVParameter* parameter = GetParameter(s);
+	if (parameter)
+		type = parameter->GetType();
 
 	return type;
 }
@@ -1902,17 +1934,13 @@ G4String TsParameterFile::GetUnitOfParameter(const G4String& s)
 
 G4bool TsParameterFile::IsChangeable(const G4String& s)
 {
-	G4String sLower = s;
-	G4StrUtil::to_lower(sLower);
-	std::map<G4String, TsVParameter*>::const_iterator iter = fRealParameters->find(sLower);
-	if (iter == fRealParameters->end()) {
-		if (fParentFile)
-			return fParentFile->IsChangeable(s);
-		else
-			Undefined(s);
+	TsVParameter* parameter = GetParameter(s);
+	if (!parameter) {
+		Undefined(s);
+		return false;
 	}
 
-	return iter->second->IsChangeable();
+	return parameter->IsChangeable();
 }
 
 
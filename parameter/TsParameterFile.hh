@@ -35,6 +35,7 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 class TsVParameter;
 class TsParameterManager;
@@ -51,6 +52,14 @@ public:
 	void ProcessTempParameters(G4bool test = false);
 	void ProtectAgainstControlByDifferentArms(G4String paramName, TsParameterFile* includeFile1, G4String prefix, G4String suffix);
 
+	// Called on the top file once the chain has been linearized. Lookups from that file then take one hash probe.
+	void BuildFlattenedParameterTable();
+	G4bool CheckFlattenedParameterTable();
+
+	// Snapshot of this file's own parameters, so that a later series of added parameters can be undone
+	void SaveParameters();
+	void RestoreSavedParameters();
+
 	G4bool ParameterExists(const G4String& parameterName);
 
 	G4int GetVectorLength(const G4String& parameterName);
@@ -94,6 +103,8 @@ private:
 	void CheckChainsForConflicts();
 
 	TsVParameter* GetParameter(const G4String& parameterName);
+	TsVParameter* GetParameterFromChain(const G4String& parameterNameInLower);
+	void StoreRealParameter(const G4String& parameterNameInLower, TsVParameter* parameter);
 	TsVParameter* GetParameterBeforeLinearized(const G4String& parameterName);
 
 	void ResetParentFileTo(TsParameterFile* parent);
@@ -112,7 +123,10 @@ private:
 	std::vector<TsParameterFile*>* fIncludeFiles;
 	std::map<G4String,TsTempParameter*>* fTempParameters;
 	std::map<G4String,TsVParameter*>* fRealParameters;
+	std::unordered_map<std::string,TsVParameter*>* fFlattenedParameters;
 	std::vector<TsVParameter*>* fTimeFeatureParameters;
+	std::map<G4String,TsVParameter*>* fSavedRealParameters;
+	std::vector<TsVParameter*>* fSavedTimeFeatureParameters;
 };
 
 #endif
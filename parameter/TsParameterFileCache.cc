@@ -0,0 +1,209 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#include "TsParameterFileCache.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+	const char cacheMagic[16] = {'T','O','P','A','S',' ','P','A','R','M',' ','C','A','C','H','E'};
+	const G4int cacheVersion = 1;
+	const uint64_t hashOffsetBasis = 14695981039346656037ULL;
+	const uint64_t hashPrime = 1099511628211ULL;
+
+	template <class T> void WriteValue(std::ofstream& out, const T& value) {
+		out.write(reinterpret_cast<const char*>(&value), sizeof value);
+	}
+
+	template <class T> G4bool ReadValue(std::ifstream& in, T& value) {
+		in.read(reinterpret_cast<char*>(&value), sizeof value);
+		return in.good();
+	}
+
+	void WriteString(std::ofstream& out, const std::string& s) {
+		WriteValue(out, uint32_t(s.size()));
+		out.write(s.data(), s.size());
+	}
+
+	G4bool ReadString(std::ifstream& in, std::string& s) {
+		uint32_t length;
+		if (!ReadValue(in, length))
+			return false;
+		s.resize(length);
+		in.read(&s[0], length);
+		return in.good();
+	}
+}
+
+
+TsParameterFileCache::TsParameterFileCache(const G4String& directory, const G4String& topasVersion)
+: fDirectory(directory), fTopasVersion(topasVersion), fNumberOfHits(0), fNumberOfMisses(0)
+{
+	// A failure here only means that later writes will fail, which just leaves the cache unused
+	mkdir(fDirectory.c_str(), 0755);
+}
+
+
+TsParameterFileCache::~TsParameterFileCache()
+{;}
+
+
+G4bool TsParameterFileCache::Read(const std::string& contents, std::vector<G4String>* names, std::vector<G4String>* values)
+{
+	const uint64_t key = GetKey(contents);
+	std::ifstream entryFile(GetEntryFileSpec(key), std::ios::binary);
+	if (!entryFile) {
+		fNumberOfMisses++;
+		return false;
+	}
+
+	// The second checksum, seeded differently, guards against a collision on the key
+	char magic[sizeof cacheMagic];
+	entryFile.read(magic, sizeof magic);
+	G4int version;
+	std::string topasVersion;
+	uint64_t storedKey, checksum, contentsLength, entryLength;
+	if (!entryFile.good() || std::memcmp(magic, cacheMagic, sizeof magic) != 0 ||
+		!ReadValue(entryFile, version) || version != cacheVersion ||
+		!ReadString(entryFile, topasVersion) || topasVersion != fTopasVersion ||
+		!ReadValue(entryFile, storedKey) || storedKey != key ||
+		!ReadValue(entryFile, contentsLength) || contentsLength != contents.size() ||
+		!ReadValue(entryFile, checksum) || checksum != Hash(contents.data(), contents.size(), ~hashOffsetBasis) ||
+		!ReadValue(entryFile, entryLength)) {
+		fNumberOfMisses++;
+		return false;
+	}
+
+	// Pairs are stored as length-prefixed strings, read in one block and split in memory
+	std::string entry(entryLength, '\0');
+	entryFile.read(&entry[0], entryLength);
+	if (!entryFile.good()) {
+		fNumberOfMisses++;
+		return false;
+	}
+
+	std::vector<G4String> cachedNames;
+	std::vector<G4String> cachedValues;
+	size_t offset = 0;
+	while (offset < entry.size()) {
+		for (G4int iString = 0; iString < 2; iString++) {
+			uint32_t length;
+			if (offset + sizeof length > entry.size()) {
+				fNumberOfMisses++;
+				return false;
+			}
+			std::memcpy(&length, entry.data() + offset, sizeof length);
+			offset += sizeof length;
+			if (offset + length > entry.size()) {
+				fNumberOfMisses++;
+				return false;
+			}
+			if (iString == 0)
+				cachedNames.push_back(G4String(entry, offset, length));
+			else
+				cachedValues.push_back(G4String(entry, offset, length));
+			offset += length;
+		}
+	}
+
+	names->insert(names->end(), cachedNames.begin(), cachedNames.end());
+	values->insert(values->end(), cachedValues.begin(), cachedValues.end());
+	fNumberOfHits++;
+	return true;
+}
+
+
+G4bool TsParameterFileCache::Write(const std::string& contents, const std::vector<G4String>& names, const std::vector<G4String>& values)
+{
+	const uint64_t key = GetKey(contents);
+	const G4String entryFileSpec = GetEntryFileSpec(key);
+
+	// Write under a private name then rename, so that concurrent jobs and threads never see a partial entry
+	G4String temporaryFileSpec = entryFileSpec + "." + std::to_string(getpid()) + "." +
+		std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	std::ofstream entryFile(temporaryFileSpec, std::ios::binary | std::ios::trunc);
+	if (!entryFile)
+		return false;
+
+	entryFile.write(cacheMagic, sizeof cacheMagic);
+	WriteValue(entryFile, cacheVersion);
+	WriteString(entryFile, fTopasVersion);
+	WriteValue(entryFile, key);
+	WriteValue(entryFile, uint64_t(contents.size()));
+	WriteValue(entryFile, Hash(contents.data(), contents.size(), ~hashOffsetBasis));
+	uint64_t entryLength = 0;
+	for (size_t iParameter = 0; iParameter < names.size(); iParameter++)
+		entryLength += 2 * sizeof(uint32_t) + names[iParameter].size() + values[iParameter].size();
+	WriteValue(entryFile, entryLength);
+	for (size_t iParameter = 0; iParameter < names.size(); iParameter++) {
+		WriteString(entryFile, names[iParameter]);
+		WriteString(entryFile, values[iParameter]);
+	}
+
+	entryFile.close();
+	if (!entryFile || std::rename(temporaryFileSpec.c_str(), entryFileSpec.c_str()) != 0) {
+		std::remove(temporaryFileSpec.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+G4String TsParameterFileCache::GetEntryFileSpec(uint64_t key) const
+{
+	std::ostringstream entryFileSpec;
+	entryFileSpec << fDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".tpc";
+	return entryFileSpec.str();
+}
+
+
+uint64_t TsParameterFileCache::GetKey(const std::string& contents) const
+{
+	uint64_t key = Hash(fTopasVersion.data(), fTopasVersion.size() + 1, hashOffsetBasis);
+	return Hash(contents.data(), contents.size(), key);
+}
+
+
+uint64_t TsParameterFileCache::Hash(const char* data, size_t length, uint64_t hash)
+{
+	for (size_t i = 0; i < length; i++) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= hashPrime;
+	}
+	return hash;
+}
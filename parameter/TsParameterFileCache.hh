@@ -0,0 +1,73 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#ifndef TsParameterFileCache_hh
+#define TsParameterFileCache_hh
+
+#include "globals.hh"
+
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+// Directory of already parsed parameter files.
+// Each entry holds the name and value pairs that TsParameterManager::ReadFile produced for one file.
+// Entries are named by a hash of the file contents and the TOPAS version,
+// so an edited file simply misses and gets a new entry while other entries stay valid.
+class TsParameterFileCache
+{
+public:
+	TsParameterFileCache(const G4String& directory, const G4String& topasVersion);
+	~TsParameterFileCache();
+
+	// Returns false if there is no valid entry for these contents
+	G4bool Read(const std::string& contents, std::vector<G4String>* names, std::vector<G4String>* values);
+
+	// Returns false if the entry could not be written (for example, to a read-only directory)
+	G4bool Write(const std::string& contents, const std::vector<G4String>& names, const std::vector<G4String>& values);
+
+	G4String GetDirectory() const { return fDirectory; }
+	G4int GetNumberOfHits() const { return fNumberOfHits; }
+	G4int GetNumberOfMisses() const { return fNumberOfMisses; }
+
+private:
+	G4String GetEntryFileSpec(uint64_t key) const;
+	uint64_t GetKey(const std::string& contents) const;
+
+	static uint64_t Hash(const char* data, size_t length, uint64_t hash);
+
+	G4String fDirectory;
+	G4String fTopasVersion;
+	std::atomic<G4int> fNumberOfHits;
+	std::atomic<G4int> fNumberOfMisses;
+};
+
+#endif
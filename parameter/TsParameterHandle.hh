@@ -0,0 +1,80 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#ifndef TsParameterHandle_hh
+#define TsParameterHandle_hh
+
+#include "TsParameterManager.hh"
+
+// A parameter name resolved once for repeated reads from code that runs per history or per track.
+// The value is fetched through the parameter manager only when the manager's parameter generation
+// has moved on, which happens whenever the current time changes (each run) or a parameter is added.
+// A handle keeps no locks, so each thread's user actions must own their own handles.
+template <typename T>
+class TsParameterHandle
+{
+public:
+	// unitCategory is only used by double handles. Leave it empty to read a unitless parameter.
+	TsParameterHandle(TsParameterManager* pM, const G4String& parameterName, const char* unitCategory = "")
+	: fPm(pM), fName(parameterName), fUnitCategory(unitCategory), fGeneration(-1), fValue() {;}
+
+	const T& Get() {
+		G4long generation = fPm->GetParameterGeneration();
+		if (generation != fGeneration) {
+			fGeneration = generation;
+			Refresh();
+		}
+		return fValue;
+	}
+
+	const G4String& GetName() const { return fName; }
+
+private:
+	void Refresh();
+
+	TsParameterManager* fPm;
+	G4String fName;
+	G4String fUnitCategory;
+	G4long fGeneration;
+	T fValue;
+};
+
+template <> void TsParameterHandle<G4double>::Refresh();
+template <> void TsParameterHandle<G4int>::Refresh();
+template <> void TsParameterHandle<G4bool>::Refresh();
+template <> void TsParameterHandle<G4String>::Refresh();
+
+typedef TsParameterHandle<G4double> TsDoubleParameterHandle;
+typedef TsParameterHandle<G4int> TsIntegerParameterHandle;
+typedef TsParameterHandle<G4bool> TsBooleanParameterHandle;
+typedef TsParameterHandle<G4String> TsStringParameterHandle;
+
+#endif
@@ -33,6 +33,7 @@
 #include "TsSequenceManager.hh"
 
 #include "TsParameterFile.hh"
+#include "TsParameterFileCache.hh"
 #include "TsTempParameter.hh"
 #include "TsVParameter.hh"
 
@@ -42,9 +43,18 @@
 #include "G4IonTable.hh"
 #include "G4VisAttributes.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Tokenizer.hh"
 
 #include "gdcmUIDGenerator.h"
 
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 #ifdef TOPAS_MT
 #include "G4AutoLock.hh"
 
@@ -53,8 +63,13 @@ namespace {
 }
 #endif
 
+namespace {
+	G4ThreadLocal G4bool hasThreadSequenceTime = false;
+	G4ThreadLocal G4double threadSequenceTime = 0.;
+}
+
 TsParameterManager::TsParameterManager(G4int argc, char** argv, G4String topasVersion):
-fTOPASVersion(topasVersion), fSqm(0), fAddParameterHasBeenCalled(false), fNowDoingParameterDump(false),
+fTOPASVersion(topasVersion), fSqm(0), fUseThreadSequenceTimes(false), fParameterGeneration(0), fAddParameterHasBeenCalled(false), fNowDoingParameterDump(false),
 fUnableToCalculateForDump(false), fHasGeometryOverlap(false),
 fNeedsTrackingAction(false), fNeedsSteppingAction(false), fNeedsChemistry(false),
 fHandledFirstEvent(false), fIsInQt(false), fIsFindingSeed(false), fUseVarianceReduction(false), fAddedParameterFileCounter(1)
@@ -95,9 +110,27 @@ fHandledFirstEvent(false), fIsInQt(false), fIsFindingSeed(false), fUseVarianceRe
 	// First TsParameterFile object created is the special one to hold transient parameters.
 	// That file will implicitly include and instantiate the file named in fTopParameterFileSpec.
 	// From there, each file may instantiate other include files.
+	// Parsed files can optionally be kept in a cache directory, so that unchanged files need not be parsed again.
+	fParameterFileCache = 0;
+	if ( getenv( "TOPAS_ParameterCacheDirectory" ) )
+		fParameterFileCache = new TsParameterFileCache(getenv( "TOPAS_ParameterCacheDirectory" ), fTOPASVersion);
+
+	// Independent include files are parsed concurrently before the parameter files are instantiated.
+	PreParseParameterFiles(fTopParameterFileSpec);
+
 	G4String transientParameterFile = "TransientParameters";
 	fParameterFile = new TsParameterFile(this, transientParameterFile, fTopParameterFileSpec, 0);
 	RegisterParameterFile(fTopParameterFileSpec, fParameterFile);
+	fPreParsedFiles.clear();
+
+	if (fParameterFileCache)
+		G4cout << "Read " << fParameterFileCache->GetNumberOfHits() << " of " <<
+		fParameterFileCache->GetNumberOfHits() + fParameterFileCache->GetNumberOfMisses() <<
+		" parameter files from cache in: " << fParameterFileCache->GetDirectory() << G4endl;
+
+	// The include graph is now linearized into a single chain, so every name has one winning definition.
+	fParameterFile->BuildFlattenedParameterTable();
+	CheckFlattenedParameterTable();
 
 	// Initialize values of time feature parameters
 	SetCurrentTime(GetDoubleParameter("Tf/TimelineStart", "Time"));
@@ -153,6 +186,7 @@ fHandledFirstEvent(false), fIsInQt(false), fIsFindingSeed(false), fUseVarianceRe
 	fScorerQuantityNames = new std::vector<G4String>;
 	fFilterNames = new std::vector<G4String>;
 	fAddedParameters = new std::map<G4String, G4String>;
+	fSavedAddedParameters = 0;
 
 	fTimer.Stop();
 }
@@ -160,6 +194,7 @@ fHandledFirstEvent(false), fIsInQt(false), fIsFindingSeed(false), fUseVarianceRe
 
 TsParameterManager::~TsParameterManager()
 {
+	delete fParameterFileCache;
 }
 
 
@@ -171,6 +206,7 @@ void TsParameterManager::UpdateTimeFeatureStore()
 	for (size_t tf =0; tf < tf_number; ++tf) {
 		(*fTimeFeatureStore)[tf]->InitializeTimeFeatureValue();
 	}
+	fParameterGeneration++;
 }
 
 
@@ -612,8 +648,32 @@ void TsParameterManager::AddParameter(const G4String& name, const G4String& valu
 
 	fParameterFile->ProcessTempParameters(test);
 
-	if (!test)
+	if (!test) {
 		(*fAddedParameters)[name] = value;
+		fParameterGeneration++;
+		CheckFlattenedParameterTable();
+	}
+}
+
+
+void TsParameterManager::SaveAddedParameters()
+{
+	fParameterFile->SaveParameters();
+
+	delete fSavedAddedParameters;
+	fSavedAddedParameters = new std::map<G4String, G4String>(*fAddedParameters);
+}
+
+
+void TsParameterManager::RestoreAddedParameters()
+{
+	if (!fSavedAddedParameters)
+		return;
+
+	fParameterFile->RestoreSavedParameters();
+	*fAddedParameters = *fSavedAddedParameters;
+	fParameterGeneration++;
+	CheckFlattenedParameterTable();
 }
 
 
@@ -645,6 +705,19 @@ void TsParameterManager::AbortSession(G4int exitCode) {
 }
 
 
+void TsParameterManager::CheckFlattenedParameterTable()
+{
+	if (!GetBooleanParameter("Ts/CheckFlattenedParameterTable"))
+		return;
+
+	if (!fParameterFile->CheckFlattenedParameterTable()) {
+		G4cerr << "Topas is exiting due to a serious error in parameter lookup." << G4endl;
+		G4cerr << "The flattened parameter table does not match the parameter file chain." << G4endl;
+		AbortSession(1);
+	}
+}
+
+
 G4bool TsParameterManager::AddParameterHasBeenCalled() {
 	return fAddParameterHasBeenCalled;
 }
@@ -1088,6 +1161,27 @@ TsSequenceManager* TsParameterManager::GetSequenceManager() {
 }
 
 
+G4double TsParameterManager::GetCurrentSequenceTime() {
+	if (fUseThreadSequenceTimes && hasThreadSequenceTime)
+		return threadSequenceTime;
+
+	return fSequenceTime;
+}
+
+
+void TsParameterManager::UseThreadSequenceTimes(G4bool useThreadSequenceTimes) {
+	fUseThreadSequenceTimes = useThreadSequenceTimes;
+	fParameterGeneration++;
+}
+
+
+void TsParameterManager::SetThreadSequenceTime(G4double t) {
+	threadSequenceTime = t;
+	hasThreadSequenceTime = true;
+	fParameterGeneration++;
+}
+
+
 G4double TsParameterManager::GetCurrentTime() {
 	return fSequenceTime;
 }
@@ -1131,6 +1225,80 @@ void TsParameterManager::GetChangeableParameters(std::vector<G4String>* paramete
 }
 
 
+void TsParameterManager::RegisterParameterConsumer(const G4String& parameterName, const G4String& consumerType,
+												   const G4String& consumerName, const G4String& directParameterName) {
+	G4String nameInLower = parameterName;
+	G4StrUtil::to_lower(nameInLower);
+
+	// Worker threads each register their own copy of the same consumer
+	auto range = fParameterConsumers.equal_range(nameInLower);
+	for (auto iter = range.first; iter != range.second; ++iter)
+		if (iter->second.type == consumerType && iter->second.name == consumerName &&
+			iter->second.directParameterName == directParameterName)
+			return;
+
+	TsParameterConsumer consumer;
+	consumer.type = consumerType;
+	consumer.name = consumerName;
+	consumer.directParameterName = directParameterName;
+	fParameterConsumers.insert(std::make_pair(nameInLower, consumer));
+}
+
+
+// Returns consumer type and direct parameter name for each registered consumer of the given parameter
+std::vector<std::pair<G4String,G4String> > TsParameterManager::GetParameterConsumers(const G4String& parameterName) {
+	G4String nameInLower = parameterName;
+	G4StrUtil::to_lower(nameInLower);
+
+	std::vector<std::pair<G4String,G4String> > consumers;
+	auto range = fParameterConsumers.equal_range(nameInLower);
+	for (auto iter = range.first; iter != range.second; ++iter)
+		consumers.push_back(std::make_pair(iter->second.type, iter->second.directParameterName));
+
+	return consumers;
+}
+
+
+void TsParameterManager::NoteParameterChangeForRun(const G4String& parameterName) {
+	G4String nameInLower = parameterName;
+	G4StrUtil::to_lower(nameInLower);
+	fChangedParametersForRun.push_back(nameInLower);
+}
+
+
+void TsParameterManager::NoteRebuildForRun(const G4String& what) {
+	fRebuildsForRun.push_back(what);
+}
+
+
+// Lists what changed since the previous run, which consumers were told about each change, and what that caused to be rebuilt
+void TsParameterManager::ReportUpdatesForRun(G4int runID) {
+	if (GetBooleanParameter("Tf/ReportUpdatesForEachRun")) {
+		G4cout << "\nUpdates for run: " << runID << G4endl;
+		if (fChangedParametersForRun.empty() && fRebuildsForRun.empty())
+			G4cout << "  Nothing changed" << G4endl;
+
+		for (size_t iChange = 0; iChange < fChangedParametersForRun.size(); iChange++) {
+			const G4String& parameterName = fChangedParametersForRun[iChange];
+			G4cout << "  Changed parameter: " << parameterName << G4endl;
+
+			auto range = fParameterConsumers.equal_range(parameterName);
+			if (range.first == range.second)
+				G4cout << "    not used by any component, scorer, filter, source, generator or view" << G4endl;
+			for (auto iter = range.first; iter != range.second; ++iter)
+				G4cout << "    updated " << iter->second.type << ": " << iter->second.name <<
+				" through parameter: " << iter->second.directParameterName << G4endl;
+		}
+
+		for (size_t iRebuild = 0; iRebuild < fRebuildsForRun.size(); iRebuild++)
+			G4cout << "  " << fRebuildsForRun[iRebuild] << G4endl;
+	}
+
+	fChangedParametersForRun.clear();
+	fRebuildsForRun.clear();
+}
+
+
 void TsParameterManager::GetAllParametersWithValues(std::vector<G4String>* parameterNames, std::vector<G4String>* parameterValues) {
 	std::map<G4String, TsVParameter*>* parameterMap = new std::map<G4String, TsVParameter*>;
 	fParameterFile->GetAllParameters(parameterMap);
@@ -1881,6 +2049,112 @@ G4String TsParameterManager::GetTopParameterFileSpec() {
 
 void TsParameterManager::ReadFile(G4String fileSpec, std::ifstream& infile,
 								  std::vector<G4String>* names, std::vector<G4String>* values) {
+	ReadParameterFile(fileSpec, infile, names, values, true);
+}
+
+
+// Parses the whole include graph ahead of TsParameterFile construction, spreading the files over worker threads.
+// Only the name and value lists are produced here. TsParameterFile still instantiates files one at a time,
+// in the usual include order, so resolution is unchanged. Files that are missing or have problems are left out,
+// so that TsParameterFile reads them again itself and reports the problem exactly as before.
+void TsParameterManager::PreParseParameterFiles(const G4String& topFileSpec) {
+	G4int nThreads = std::thread::hardware_concurrency();
+	if ( getenv( "TOPAS_ParameterParsingThreads" ) )
+		nThreads = atoi( getenv( "TOPAS_ParameterParsingThreads" ) );
+	if (nThreads <= 1)
+		return;
+
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::deque<G4String> pending;
+	std::set<G4String> seen;
+	G4int nBusy = 0;
+
+	pending.push_back(topFileSpec);
+	seen.insert(topFileSpec);
+	seen.insert("TOPAS_Built_In_Defaults");
+
+	auto work = [&]() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			workAvailable.wait(lock, [&]() { return !pending.empty() || nBusy == 0; });
+			if (pending.empty())
+				break;
+
+			G4String fileSpec = pending.front();
+			pending.pop_front();
+			nBusy++;
+			lock.unlock();
+
+			std::vector<G4String> names;
+			std::vector<G4String> values;
+			std::ifstream infile(fileSpec);
+			G4bool parsed = infile && ReadParameterFile(fileSpec, infile, &names, &values, false);
+
+			lock.lock();
+			if (parsed) {
+				for (size_t iToken = 0; iToken < names.size(); iToken++) {
+					G4String nameInLower = names[iToken];
+					G4StrUtil::to_lower(nameInLower);
+					if (nameInLower == "includefile") {
+						G4Tokenizer next(values[iToken]);
+						for (G4String includeFileSpec = next(); !includeFileSpec.empty(); includeFileSpec = next())
+							if (seen.insert(includeFileSpec).second)
+								pending.push_back(includeFileSpec);
+					}
+				}
+				TsPreParsedFile& preParsedFile = fPreParsedFiles[fileSpec];
+				preParsedFile.names.swap(names);
+				preParsedFile.values.swap(values);
+			}
+			nBusy--;
+			workAvailable.notify_all();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (G4int iThread = 0; iThread < nThreads; iThread++)
+		threads.emplace_back(work);
+
+	for (size_t iThread = 0; iThread < threads.size(); iThread++)
+		threads[iThread].join();
+}
+
+
+G4bool TsParameterManager::TakePreParsedFile(const G4String& fileSpec, std::vector<G4String>* names, std::vector<G4String>* values) {
+	std::map<G4String, TsPreParsedFile>::iterator iter = fPreParsedFiles.find(fileSpec);
+	if (iter == fPreParsedFiles.end())
+		return false;
+
+	names->swap(iter->second.names);
+	values->swap(iter->second.values);
+	fPreParsedFiles.erase(iter);
+	return true;
+}
+
+
+// Returns false, without reporting anything, if abortOnProblem is false and the file has a problem.
+G4bool TsParameterManager::ReadParameterFile(const G4String& fileSpec, std::istream& infile,
+											 std::vector<G4String>* names, std::vector<G4String>* values, G4bool abortOnProblem) {
+	if (!fParameterFileCache)
+		return ParseParameterStream(fileSpec, infile, names, values, abortOnProblem);
+
+	std::ostringstream buffer;
+	buffer << infile.rdbuf();
+	const std::string contents = buffer.str();
+	if (fParameterFileCache->Read(contents, names, values))
+		return true;
+
+	std::istringstream stream(contents);
+	if (!ParseParameterStream(fileSpec, stream, names, values, abortOnProblem))
+		return false;
+	fParameterFileCache->Write(contents, *names, *values);
+	return true;
+}
+
+
+G4bool TsParameterManager::ParseParameterStream(const G4String& fileSpec, std::istream& infile,
+												std::vector<G4String>* names, std::vector<G4String>* values, G4bool abortOnProblem) {
 	const std::string& delchar  = "=";
 	const std::string& comchar   = "#";
 	static const char forbiddeninName[] = "=+-*\"'`# \t\n\r";
@@ -1959,6 +2233,7 @@ void TsParameterManager::ReadFile(G4String fileSpec, std::ifstream& infile,
 			if (name!="") {
 				// Protect against reserved characters in name
 				if (name.find_first_of(forbiddeninName) < name.size()) {
+					if (!abortOnProblem) return false;
 					char badChar = name[name.find_first_of(forbiddeninName)];
 					G4String badString(1,badChar);
 					if (badChar=='\"') badString = "Double Quotes";
@@ -1973,6 +2248,7 @@ void TsParameterManager::ReadFile(G4String fileSpec, std::ifstream& infile,
 
 				// Protect against reserved characters in value
  				if (value.find_first_of(forbiddeninValue) < value.size()) {
+					if (!abortOnProblem) return false;
 					char badChar = value[value.find_first_of(forbiddeninValue)];
 					G4String badString(1,badChar);
 					if (badChar=='\r') badString = "Carriage Return";
@@ -1994,7 +2270,7 @@ void TsParameterManager::ReadFile(G4String fileSpec, std::ifstream& infile,
 	names->push_back(name);
 	values->push_back(value);
 
-	return;
+	return true;
 }
 
 
@@ -33,6 +33,7 @@
 
 #include <map>
 #include <vector>
+#include <atomic>
 
 #include "TsTopasConfig.hh"
 
@@ -46,6 +47,7 @@
 
 class TsSequenceManager;
 class TsParameterFile;
+class TsParameterFileCache;
 class TsVParameter;
 class G4VisAttributes;
 class G4ParticleDefinition;
@@ -145,6 +147,10 @@ public:
 	// Add a parameter
 	void AddParameter(const G4String& name, const G4String& value, G4bool test = false, G4bool permissive = false);
 
+	// Lets a parameter sweep return to the parameters as they were before any sweep variant was added
+	void SaveAddedParameters();
+	void RestoreAddedParameters();
+
 	// Get the part of a string after the last slash, in lower case
 	G4String GetPartAfterLastSlash(const G4String& name);
 
@@ -164,6 +170,9 @@ public:
 
 	G4double GetCurrentTime();
 
+	// Moves on whenever a parameter value may have changed. Used by TsParameterHandle to keep its cached value.
+	G4long GetParameterGeneration() { return fParameterGeneration.load(std::memory_order_acquire); }
+
 	G4int GetRunID();
 
 	void HandleFirstEvent();
@@ -203,7 +212,11 @@ public:
 
 	std::vector<TsVParameter*>* GetTimeFeatureStore(G4double currentTime);
 
-	G4double GetCurrentSequenceTime() {return fSequenceTime;}
+	G4double GetCurrentSequenceTime();
+
+	// Lets each thread evaluate time features at its own time during a run that merges several sequential times
+	void UseThreadSequenceTimes(G4bool useThreadSequenceTimes);
+	void SetThreadSequenceTime(G4double t);
 
 	void SetSequenceManager(TsSequenceManager* sqM);
 	TsSequenceManager* GetSequenceManager();
@@ -211,6 +224,14 @@ public:
 	G4bool AddParameterHasBeenCalled();
 
 	void GetChangeableParameters(std::vector<G4String>* names, std::vector<G4String>* values);
+
+	// Dependency graph from changeable parameters to the components, scorers, filters, sources, generators and views that read them
+	void RegisterParameterConsumer(const G4String& parameterName, const G4String& consumerType,
+								   const G4String& consumerName, const G4String& directParameterName);
+	void NoteParameterChangeForRun(const G4String& parameterName);
+	void NoteRebuildForRun(const G4String& what);
+	void ReportUpdatesForRun(G4int runID);
+	std::vector<std::pair<G4String,G4String> > GetParameterConsumers(const G4String& parameterName);
 	void GetAllParametersWithValues(std::vector<G4String>* names, std::vector<G4String>* values);
 	G4String GetParameterValueAsString(G4String parameterType, G4String parameterName);
 	void DumpParameters(G4double currentTime, G4bool includeDefaults);
@@ -253,6 +274,7 @@ public:
 	G4String GetTopParameterFileSpec();
 
 	void ReadFile(G4String fileSpec, std::ifstream& inputStream, std::vector<G4String>* names, std::vector<G4String>* values);
+	G4bool TakePreParsedFile(const G4String& fileSpec, std::vector<G4String>* names, std::vector<G4String>* values);
 	void Trim(std::string& inputString);
 	void GetLineWithoutNewlineAndCarriageReturnIssues(std::istream& is, std::string& t);
 	void ReplaceStringInLine(std::string& str, const std::string& from, const std::string& to);
@@ -269,8 +291,12 @@ public:
 
 private:
 	void CreateUnits();
+	void CheckFlattenedParameterTable();
+	void PreParseParameterFiles(const G4String& topFileSpec);
+	G4bool ReadParameterFile(const G4String& fileSpec, std::istream& inputStream, std::vector<G4String>* names, std::vector<G4String>* values, G4bool abortOnProblem);
+	G4bool ParseParameterStream(const G4String& fileSpec, std::istream& inputStream, std::vector<G4String>* names, std::vector<G4String>* values, G4bool abortOnProblem);
 
-	void SetCurrentTime(G4double t) { fSequenceTime=t;}
+	void SetCurrentTime(G4double t) { fSequenceTime=t; fParameterGeneration++;}
 
 	G4int ExpectExponent(const char* str);
 
@@ -280,10 +306,28 @@ private:
 
 	G4String fTopParameterFileSpec;
 	TsParameterFile* fParameterFile;
+	TsParameterFileCache* fParameterFileCache;
+
+	struct TsPreParsedFile {
+		std::vector<G4String> names;
+		std::vector<G4String> values;
+	};
+	std::map<G4String, TsPreParsedFile> fPreParsedFiles;
+
+	struct TsParameterConsumer {
+		G4String type;
+		G4String name;
+		G4String directParameterName;
+	};
+	std::multimap<G4String, TsParameterConsumer> fParameterConsumers;
+	std::vector<G4String> fChangedParametersForRun;
+	std::vector<G4String> fRebuildsForRun;
 	TsSequenceManager* fSqm;
 	G4Timer	fTimer;
 	G4double fSequenceTime;
+	G4bool fUseThreadSequenceTimes;
 	G4bool fIsRandomMode;
+	std::atomic<G4long> fParameterGeneration;
 
 #ifdef TOPAS_MT
 	G4Cache<G4String> fLastDirectAction;
@@ -323,6 +367,7 @@ private:
 	std::vector<G4String>* fFilterNames;
 
 	std::map<G4String, G4String>* fAddedParameters;
+	std::map<G4String, G4String>* fSavedAddedParameters;
 	G4int fAddedParameterFileCounter;
 };
 #endif
@@ -32,8 +32,7 @@
 #define TsStringFromTimeFeatureStep_hh
 
 #include "TsVParameter.hh"
-
-#include <map>
+#include "TsTimeFeatureStepTable.hh"
 
 class TsStringFromTimeFeatureStep : public TsVParameter
 {
@@ -56,8 +55,7 @@ private:
 
 	G4String* fValues;
 	G4String* fValuesIfParameterNames;
-	std::map<G4double, G4int>* fTimes;
-	G4double fRange;
+	TsTimeFeatureStepTable fTimes;
 };
 
 #endif
@@ -0,0 +1,127 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#include "TsTimeFeatureStepTable.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+TsTimeFeatureStepTable::TsTimeFeatureStepTable()
+: fRange(0), fGridStart(0), fGridInverseWidth(0)
+{
+}
+
+
+TsTimeFeatureStepTable::~TsTimeFeatureStepTable()
+{
+}
+
+
+void TsTimeFeatureStepTable::Fill(G4int nTimes, G4double* times) {
+	fSortedTimes.clear();
+	fIndices.clear();
+	fGrid.clear();
+	fGridInverseWidth = 0;
+
+	if (nTimes < 1) {
+		fRange = 0;
+		return;
+	}
+
+	fRange = times[nTimes-1];
+
+	// Sort by time. When a time is repeated, the first entry wins.
+	std::vector<std::pair<G4double, G4int> > entries;
+	entries.reserve(nTimes);
+	for (G4int i = 0; i < nTimes; ++i)
+		entries.push_back(std::make_pair(times[i], i));
+	std::stable_sort(entries.begin(), entries.end(),
+		[](const std::pair<G4double, G4int>& a, const std::pair<G4double, G4int>& b) { return a.first < b.first; });
+
+	fSortedTimes.reserve(nTimes);
+	fIndices.reserve(nTimes);
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (!fSortedTimes.empty() && entries[i].first == fSortedTimes.back())
+			continue;
+		fSortedTimes.push_back(entries[i].first);
+		fIndices.push_back(entries[i].second);
+	}
+
+	G4double width = fSortedTimes.back() - fSortedTimes.front();
+	if (fSortedTimes.size() < 2 || !(width > 0))
+		return;
+
+	// Each grid cell remembers where upper_bound of its lower edge lands.
+	size_t nCells = fSortedTimes.size();
+	fGridStart = fSortedTimes.front();
+	fGridInverseWidth = nCells / width;
+	fGrid.resize(nCells);
+	for (size_t i = 0; i < nCells; ++i) {
+		G4double edge = fGridStart + i / fGridInverseWidth;
+		fGrid[i] = std::upper_bound(fSortedTimes.begin(), fSortedTimes.end(), edge) - fSortedTimes.begin();
+	}
+}
+
+
+G4double TsTimeFeatureStepTable::WrapTime(G4double t) const {
+	if (fRange > 0 && t >= fRange)
+		t = std::fmod(t, fRange);
+	return t;
+}
+
+
+G4int TsTimeFeatureStepTable::GetIndex(G4double t) const {
+	size_t n = fSortedTimes.size();
+	if (n == 0)
+		return 0;
+
+	size_t pos;
+	if (fGrid.empty()) {
+		pos = std::upper_bound(fSortedTimes.begin(), fSortedTimes.end(), t) - fSortedTimes.begin();
+	} else if (t < fGridStart) {
+		pos = 0;
+	} else {
+		G4double cell = (t - fGridStart) * fGridInverseWidth;
+		size_t iCell = cell < fGrid.size() ? (size_t)cell : fGrid.size() - 1;
+		pos = fGrid[iCell];
+
+		// The grid is only a starting guess. Walk to the exact upper_bound.
+		while (pos > 0 && fSortedTimes[pos-1] > t)
+			--pos;
+		while (pos < n && fSortedTimes[pos] <= t)
+			++pos;
+	}
+
+	if (pos == n)
+		pos = n - 1;
+	return fIndices[pos];
+}
@@ -0,0 +1,64 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#ifndef TsTimeFeatureStepTable_hh
+#define TsTimeFeatureStepTable_hh
+
+#include "globals.hh"
+
+#include <vector>
+
+// Sorted time table shared by the Step time features.
+// Lookups use a uniform grid over the time range to jump close to the answer,
+// so that tables with thousands of entries cost about the same as short ones.
+class TsTimeFeatureStepTable
+{
+public:
+	TsTimeFeatureStepTable();
+	~TsTimeFeatureStepTable();
+
+	void Fill(G4int nTimes, G4double* times);
+
+	G4double WrapTime(G4double t) const;
+	G4int GetIndex(G4double t) const;
+
+	G4double GetRange() const { return fRange; }
+
+private:
+	G4double fRange;
+	std::vector<G4double> fSortedTimes;
+	std::vector<G4int> fIndices;
+	std::vector<size_t> fGrid;
+	G4double fGridStart;
+	G4double fGridInverseWidth;
+};
+
+#endif
@@ -43,8 +43,6 @@ TsUnitlessFromTimeFeatureStep::TsUnitlessFromTimeFeatureStep(TsParameterManager*
 	ConvertToDoubleVector(nValues, values, fValues, fValuesIfParameterNames);
 	G4String initvalue  = tempParameter->GetValue();
 	fCurrentValue = (G4UIcommand::ConvertToDouble(initvalue));
-	fRange    = 0;
-	fTimes    = new std::map<G4double, G4int>;
 }
 
 
@@ -63,10 +61,9 @@ G4double TsUnitlessFromTimeFeatureStep::GetUnitlessValue()
 {
 	fUsed = true;
 	G4double t = fPm->GetCurrentSequenceTime();
-	while(t >= fRange ) { t -= fRange; }
+	t = fTimes.WrapTime(t);
 	if (t == fLatestUpdatedTime) { return fCurrentValue;}
-	std::map<G4double, G4int>::const_iterator pos = fTimes->upper_bound(t);
-	G4int idx = pos->second;
+	G4int idx = fTimes.GetIndex(t);
 	if ( fValuesIfParameterNames[idx] =="" ) {
 		return fValues[idx];
 	} else {
@@ -91,10 +88,7 @@ void TsUnitlessFromTimeFeatureStep::InitializeTimeFeatureValue()
 	}
 
 	G4double* times = fPm->GetDoubleVector(fNameOfBaseParameter+"/Times", "Time");
-	fRange = times[ntimes-1];
-	for (int i=0; i < ntimes; ++i) {
-		fTimes->insert(std::make_pair(times[i],i));
-	}
+	fTimes.Fill(ntimes, times);
 }
 
 G4bool TsUnitlessFromTimeFeatureStep::ValueHasChanged() {
@@ -50,7 +50,7 @@
 #include "G4Tokenizer.hh"
 
 TsGeneratorManager::TsGeneratorManager(TsParameterManager* pM, TsExtensionManager* eM, TsGeometryManager* gM, TsSourceManager* prM, TsFilterManager* fM,  TsSequenceManager* sqM)
-:fPm(pM), fGm(gM), fPrm(prM), fFm(fM), fIsExecutingSequence(false), fPrimaryCounter(0), fCurrentGenerator(0)
+:fPm(pM), fGm(gM), fPrm(prM), fFm(fM), fSqm(sqM), fIsExecutingSequence(false), fMergedTimeIndex(-1), fMergedTimeRunID(-1), fPrimaryCounter(0), fCurrentGenerator(0)
 {
 	fVerbosity = fPm->GetIntegerParameter("So/Verbosity");
 
@@ -184,9 +184,30 @@ void TsGeneratorManager::GeneratePrimaries(G4Event* anEvent)
 			fPm->AbortSession(1);
 		}
 	} else {
+		// In random time mode, each event may get its own time within a single run
+		if (fSqm->IsSamplingTimePerEvent())
+			fSqm->UpdateForNewEventTime(this);
+
+		// When several sequential times share one run, the event ID tells which time this event belongs to
+		G4int mergedTimeIndex = -1;
+		if (fSqm->IsMergingTimes()) {
+			mergedTimeIndex = fSqm->GetMergedTimeIndex(anEvent->GetEventID());
+			if (mergedTimeIndex != fMergedTimeIndex || fPm->GetRunID() != fMergedTimeRunID) {
+				fMergedTimeIndex = mergedTimeIndex;
+				fMergedTimeRunID = fPm->GetRunID();
+				fSqm->UpdateForMergedTime(this, mergedTimeIndex);
+			}
+		}
+
 		// Give each generator the opportunity to generate primaries.
 		std::vector<TsVGenerator*>::iterator iter;
 		for (iter=fGenerators.begin(); iter!=fGenerators.end(); iter++) {
+			if (mergedTimeIndex >= 0) {
+				if (fSqm->SourceHasHistoryInMergedTime(mergedTimeIndex, (*iter)->GetSource()->GetName(), anEvent->GetEventID()))
+					(*iter)->GeneratePrimaries(anEvent);
+				continue;
+			}
+
 			if (fPm->IsRandomMode())
 				limit = (*iter)->GetSource()->GetNumberOfHistoriesInRandomJob();
 			else
@@ -222,7 +243,8 @@ void TsGeneratorManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 		G4String nameToLower = name;
 		G4StrUtil::to_lower(nameToLower);
 		std::multimap< G4String, std::pair<TsVGenerator*,G4String> >::const_iterator iter;
-		for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end() && !matched; iter++) {
+		std::multimap< G4String, std::pair<TsVGenerator*,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(nameToLower);
+		for (iter = fChangeableParameterMap.lower_bound(nameToLower); iter != last && !matched; iter++) {
 			G4String gotParm = iter->first;
 			TsVGenerator* gotGenerator = iter->second.first;
 			G4String gotDirectParm = iter->second.second;
@@ -232,6 +254,7 @@ void TsGeneratorManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 		if (!matched) {
 			fChangeableParameterMap.insert(std::make_pair(nameToLower, std::make_pair(fCurrentGenerator, directParm)));
+			fPm->RegisterParameterConsumer(name, "generator", fCurrentGenerator->GetName(), directParm);
 			if (fPm->IGetIntegerParameter("Tf/Verbosity") > 0)
 				G4cout << "Registered use of changeable parameter: " << name << "  by generator: " << fCurrentGenerator->GetName() << G4endl;
 		}
@@ -248,7 +271,8 @@ void TsGeneratorManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 void TsGeneratorManager::UpdateForSpecificParameterChange(G4String parameter) {
 	std::multimap< G4String, std::pair<TsVGenerator*,G4String> >::const_iterator iter;
-	for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end(); iter++) {
+	std::multimap< G4String, std::pair<TsVGenerator*,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(parameter);
+	for (iter = fChangeableParameterMap.lower_bound(parameter); iter != last; iter++) {
 		if (iter->first==parameter) {
 			G4String directParameterName = iter->second.second;
 			if (fVerbosity>0)
@@ -267,6 +291,13 @@ void TsGeneratorManager::UpdateForNewRun(G4bool rebuiltSomeComponents) {
 }
 
 
+void TsGeneratorManager::UpdateForNewTime() {
+	std::vector<TsVGenerator*>::iterator iter;
+	for (iter=fGenerators.begin(); iter!=fGenerators.end(); iter++)
+		(*iter)->UpdateForNewTime();
+}
+
+
 void TsGeneratorManager::ClearGenerators() {
 	std::vector<TsVGenerator*>::iterator iter;
 	for (iter=fGenerators.begin(); iter!=fGenerators.end(); iter++)
@@ -68,6 +68,7 @@ public:
 	void NoteAnyUseOfChangeableParameters(const G4String& name);
 	void UpdateForSpecificParameterChange(G4String parameter);
 	void UpdateForNewRun(G4bool rebuiltSomeComponents);
+	void UpdateForNewTime();
 	void ClearGenerators();
 
 	void Finalize();
@@ -77,10 +78,13 @@ private:
 	TsGeometryManager* fGm;
 	TsSourceManager* fPrm;
 	TsFilterManager* fFm;
+	TsSequenceManager* fSqm;
 
 	G4int fVerbosity;
 
 	G4bool fIsExecutingSequence;
+	G4int fMergedTimeIndex;
+	G4int fMergedTimeRunID;
 
 	G4int fPrimaryCounter;
 
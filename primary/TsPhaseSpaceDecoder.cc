@@ -0,0 +1,212 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#include "TsPhaseSpaceDecoder.hh"
+
+#include <charconv>
+#include <cstring>
+#include <cmath>
+
+// Field readers for ASCII lines. Each skips leading white space and reads one number in place,
+// following the rules of stream extraction: a leading plus sign is accepted, the field ends at the
+// first character that cannot continue the number, and values out of range for the type are errors.
+namespace {
+	const char* SkipSpace(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == '\v' || *p == '\f'))
+			p++;
+		if (p < end - 1 && *p == '+' && p[1] != '-' && p[1] != '+')
+			p++;
+		return p;
+	}
+
+	template <typename T>
+	G4bool ReadInteger(const char*& p, const char* end, T& value)
+	{
+		p = SkipSpace(p, end);
+		std::from_chars_result result = std::from_chars(p, end, value);
+		if (result.ec != std::errc())
+			return false;
+		p = result.ptr;
+		return true;
+	}
+
+	G4bool ReadFloat(const char*& p, const char* end, G4float& value)
+	{
+		p = SkipSpace(p, end);
+		std::from_chars_result result = std::from_chars(p, end, value);
+		if (result.ec != std::errc() || !std::isfinite(value))
+			return false;
+		p = result.ptr;
+		return true;
+	}
+
+	G4bool ReadFlag(const char*& p, const char* end, G4bool& value)
+	{
+		long flag;
+		if (!ReadInteger(p, end, flag) || (flag != 0 && flag != 1))
+			return false;
+		value = (flag == 1);
+		return true;
+	}
+}
+
+TsPhaseSpaceDecoder::TsPhaseSpaceDecoder() :
+fFormat(ASCII), fRecordLength(0), fLimitedHasZ(true), fLimitedHasWeight(true),
+fLimitedAssumePhotonIsNewHistory(false), fLimitedAssumeEveryParticleIsNewHistory(false),
+fLimitedAssumeFirstParticleIsNewHistory(false)
+{
+}
+
+
+TsPhaseSpaceDecoder::~TsPhaseSpaceDecoder()
+{
+}
+
+
+void TsPhaseSpaceDecoder::DecodeRecord(const char* buffer, TsPhaseSpaceRecord& record) const
+{
+	const char* p = buffer;
+
+	if (fFormat == LIMITED) {
+		char conflatedParticleCodeChar;
+		std::memcpy(&conflatedParticleCodeChar, p, 1);
+		p += 1;
+		G4int conflatedParticleCode = G4int(conflatedParticleCodeChar);
+		record.cosZIsNegative = (conflatedParticleCode < 0);
+		record.particleCode = std::abs(conflatedParticleCode);
+
+		G4float conflatedEnergy;
+		std::memcpy(&conflatedEnergy, p, sizeof conflatedEnergy);
+		p += sizeof conflatedEnergy;
+		record.isNewHistory = (conflatedEnergy < 0.);
+
+		if (fLimitedAssumeEveryParticleIsNewHistory ||
+			(fLimitedAssumePhotonIsNewHistory && record.particleCode == 1))
+			record.isNewHistory = true;
+
+		record.kEnergy = std::fabs(conflatedEnergy);
+
+		std::memcpy(&record.posX, p, sizeof record.posX);
+		p += sizeof record.posX;
+		std::memcpy(&record.posY, p, sizeof record.posY);
+		p += sizeof record.posY;
+
+		if (fLimitedHasZ) {
+			std::memcpy(&record.posZ, p, sizeof record.posZ);
+			p += sizeof record.posZ;
+		} else {
+			record.posZ = 0.;
+		}
+
+		std::memcpy(&record.dCos1, p, sizeof record.dCos1);
+		p += sizeof record.dCos1;
+		std::memcpy(&record.dCos2, p, sizeof record.dCos2);
+		p += sizeof record.dCos2;
+
+		if (fLimitedHasWeight)
+			std::memcpy(&record.weight, p, sizeof record.weight);
+		else
+			record.weight = 1.;
+	} else {
+		std::memcpy(&record.posX,         p, sizeof record.posX);         p += sizeof record.posX;
+		std::memcpy(&record.posY,         p, sizeof record.posY);         p += sizeof record.posY;
+		std::memcpy(&record.posZ,         p, sizeof record.posZ);         p += sizeof record.posZ;
+		std::memcpy(&record.dCos1,        p, sizeof record.dCos1);        p += sizeof record.dCos1;
+		std::memcpy(&record.dCos2,        p, sizeof record.dCos2);        p += sizeof record.dCos2;
+		std::memcpy(&record.kEnergy,      p, sizeof record.kEnergy);      p += sizeof record.kEnergy;
+		std::memcpy(&record.weight,       p, sizeof record.weight);       p += sizeof record.weight;
+		std::memcpy(&record.particleCode, p, sizeof record.particleCode); p += sizeof record.particleCode;
+		record.cosZIsNegative = (*p++ != 0);
+		record.isNewHistory   = (*p != 0);
+	}
+}
+
+
+G4bool TsPhaseSpaceDecoder::DecodeLine(const char* begin, const char* end, TsPhaseSpaceRecord& record) const
+{
+	const char* p = begin;
+	return ReadFloat(p, end, record.posX) && ReadFloat(p, end, record.posY) && ReadFloat(p, end, record.posZ) &&
+		ReadFloat(p, end, record.dCos1) && ReadFloat(p, end, record.dCos2) &&
+		ReadFloat(p, end, record.kEnergy) && ReadFloat(p, end, record.weight) &&
+		ReadInteger(p, end, record.particleCode) &&
+		ReadFlag(p, end, record.cosZIsNegative) && ReadFlag(p, end, record.isNewHistory);
+}
+
+
+G4int TsPhaseSpaceDecoder::GetMinimumRecordLength() const
+{
+	if (fFormat == LIMITED)
+		return 1 + 5 * sizeof(G4float) + (fLimitedHasZ ? sizeof(G4float) : 0) + (fLimitedHasWeight ? sizeof(G4float) : 0);
+	else if (fFormat == BINARY)
+		return 7 * sizeof(G4float) + sizeof(G4int) + 2;
+	return 0;
+}
+
+
+G4int TsPhaseSpaceDecoder::LimitedCodeToPDG(G4int limitedCode)
+{
+	switch(limitedCode)
+	{
+		case 1:
+			return 22;  // gamma
+		case 2:
+			return 11;  // electron
+		case 3:
+			return -11;  // positron
+		case 4:
+			return 2112;  // neutron
+		case 5:
+			return 2212;  // proton
+		default:
+			return 0;
+	}
+}
+
+
+G4int TsPhaseSpaceDecoder::PDGToLimitedCode(G4int pdgCode)
+{
+	switch(pdgCode)
+	{
+		case 22:
+			return 1;  // gamma
+		case 11:
+			return 2;  // electron
+		case -11:
+			return 3;  // positron
+		case 2112:
+			return 4;  // neutron
+		case 2212:
+			return 5;  // proton
+		default:
+			return 0;
+	}
+}
@@ -0,0 +1,88 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#ifndef TsPhaseSpaceDecoder_hh
+#define TsPhaseSpaceDecoder_hh
+
+#include "globals.hh"
+
+// One particle record exactly as stored in a phase space file,
+// before unit conversion, axis scaling or particle definition lookup.
+struct TsPhaseSpaceRecord
+{
+	G4float posX;
+	G4float posY;
+	G4float posZ;
+	G4float dCos1;
+	G4float dCos2;
+	G4float kEnergy;
+	G4float weight;
+	G4int particleCode;
+	G4bool cosZIsNegative;
+	G4bool isNewHistory;
+};
+
+class TsPhaseSpaceDecoder
+{
+public:
+	enum Format { ASCII, BINARY, LIMITED };
+
+	TsPhaseSpaceDecoder();
+	~TsPhaseSpaceDecoder();
+
+	// Decode one fixed length record (Binary or Limited). Buffer must hold fRecordLength bytes.
+	void DecodeRecord(const char* buffer, TsPhaseSpaceRecord& record) const;
+
+	// Decode one ASCII line (without its terminating newline).
+	// Returns false if the line does not hold the ten required columns.
+	G4bool DecodeLine(const char* begin, const char* end, TsPhaseSpaceRecord& record) const;
+
+	G4bool IsFixedLength() const { return fFormat != ASCII; }
+
+	// Fewest bytes a Binary or Limited record can occupy given the stored columns
+	G4int GetMinimumRecordLength() const;
+
+	// Translate Limited format particle ID to PDG code. Returns zero if not supported.
+	static G4int LimitedCodeToPDG(G4int limitedCode);
+
+	// Translate PDG code to Limited format particle ID. Returns zero if not supported.
+	static G4int PDGToLimitedCode(G4int pdgCode);
+
+	Format fFormat;
+	G4int fRecordLength;
+	G4bool fLimitedHasZ;
+	G4bool fLimitedHasWeight;
+	G4bool fLimitedAssumePhotonIsNewHistory;
+	G4bool fLimitedAssumeEveryParticleIsNewHistory;
+	G4bool fLimitedAssumeFirstParticleIsNewHistory;
+};
+
+#endif
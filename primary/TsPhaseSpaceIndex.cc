@@ -0,0 +1,652 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#include "TsPhaseSpaceIndex.hh"
+
+#include "G4Threading.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+	const char indexMagic[16] = {'T','O','P','A','S',' ','P','H','S','P',' ','I','N','D','E','X'};
+	const G4int indexVersion = 1;
+	const G4long nominalChunkLength = 16 * 1024 * 1024;
+	const G4long sampleLength = 1024 * 1024;
+	const uint64_t hashOffsetBasis = 14695981039346656037ULL;
+	const uint64_t hashPrime = 1099511628211ULL;
+
+	template <class T> void WriteValue(std::ofstream& out, const T& value) {
+		out.write(reinterpret_cast<const char*>(&value), sizeof value);
+	}
+
+	template <class T> G4bool ReadValue(std::ifstream& in, T& value) {
+		in.read(reinterpret_cast<char*>(&value), sizeof value);
+		return in.good();
+	}
+}
+
+
+struct TsPhaseSpaceIndex::ChunkResult
+{
+	ChunkResult() : histories(0), nonEmptyHistories(0), particles(0), firstExcitedIonCode(0),
+	hasRecords(false), firstPosition(0), firstRecordContinuesHistory(false), endsWithEmptyHistory(false),
+	problem(NONE), problemPosition(0), checksum(0) {}
+
+	G4long histories;
+	G4long nonEmptyHistories;
+	G4long particles;
+	G4int firstExcitedIonCode;
+	G4bool hasRecords;
+	G4long firstPosition;
+	G4bool firstRecordContinuesHistory;
+	G4bool endsWithEmptyHistory;
+	Problem problem;
+	G4long problemPosition;
+	uint64_t checksum;
+	std::vector<Checkpoint> checkpoints;
+};
+
+
+TsPhaseSpaceIndex::TsPhaseSpaceIndex(const G4String& dataFileSpec, const TsPhaseSpaceDecoder& decoder, G4int numberOfThreads) :
+fDataFileSpec(dataFileSpec), fDecoder(decoder), fNumberOfThreads(numberOfThreads), fFileSize(-1), fFileModificationTime(0),
+fChunkLength(nominalChunkLength), fNumberOfHistories(0), fNumberOfNonEmptyHistories(0), fNumberOfParticles(0),
+fFirstExcitedIonCode(0), fProblem(NONE), fProblemPosition(0), fChecksum(0), fSampleChecksum(0)
+{
+	if (fNumberOfThreads < 1)
+		fNumberOfThreads = G4Threading::G4GetNumberOfCores();
+	if (fNumberOfThreads < 1)
+		fNumberOfThreads = 1;
+
+	struct stat stat_buf;
+	if (stat(fDataFileSpec.c_str(), &stat_buf) == 0) {
+		fFileSize = stat_buf.st_size;
+		fFileModificationTime = stat_buf.st_mtime;
+	}
+
+	// Fixed length records must never straddle two chunks
+	if (fDecoder.IsFixedLength() && fDecoder.fRecordLength > 0)
+		fChunkLength = std::max(1L, nominalChunkLength / fDecoder.fRecordLength) * fDecoder.fRecordLength;
+}
+
+
+TsPhaseSpaceIndex::~TsPhaseSpaceIndex()
+{
+}
+
+
+void TsPhaseSpaceIndex::Build(G4int checkpointStride, G4int showParticleCountAtInterval)
+{
+	fNumberOfHistories = 0;
+	fNumberOfNonEmptyHistories = 0;
+	fNumberOfParticles = 0;
+	fFirstExcitedIonCode = 0;
+	fProblem = NONE;
+	fProblemPosition = 0;
+	fCheckpoints.clear();
+
+	if (fFileSize < 0) {
+		fProblem = UNREADABLE_FILE;
+		return;
+	}
+
+	if (checkpointStride < 1)
+		checkpointStride = 1;
+
+	std::vector<ChunkResult> results(GetNumberOfChunks());
+	std::atomic<G4long> particlesScanned(0);
+
+	RunOnChunks([&](G4long chunk, std::ifstream& dataFile, std::vector<char>& buffer) {
+		ScanChunk(chunk, dataFile, buffer, results[chunk], checkpointStride);
+		particlesScanned += results[chunk].particles;
+	}, &particlesScanned, showParticleCountAtInterval);
+
+	// Stitch chunks together in file order.
+	// A chunk that opens with a continuation particle is only an error if the previous chunk closed with an empty history.
+	G4bool previousChunkEndsWithEmptyHistory = false;
+	fChecksum = Hash(reinterpret_cast<const char*>(&fFileSize), sizeof fFileSize, hashOffsetBasis);
+	for (size_t iChunk = 0; iChunk < results.size(); iChunk++) {
+		ChunkResult& result = results[iChunk];
+
+		if (result.hasRecords && result.firstRecordContinuesHistory && previousChunkEndsWithEmptyHistory) {
+			fProblem = PARTICLE_AFTER_EMPTY_HISTORY;
+			fProblemPosition = result.firstPosition;
+			return;
+		}
+
+		if (result.problem != NONE) {
+			fProblem = result.problem;
+			fProblemPosition = result.problemPosition;
+			return;
+		}
+
+		for (size_t iCheckpoint = 0; iCheckpoint < result.checkpoints.size(); iCheckpoint++) {
+			Checkpoint checkpoint = result.checkpoints[iCheckpoint];
+			checkpoint.histories += fNumberOfHistories;
+			checkpoint.nonEmptyHistories += fNumberOfNonEmptyHistories;
+			checkpoint.particles += fNumberOfParticles;
+			fCheckpoints.push_back(checkpoint);
+		}
+
+		fNumberOfHistories += result.histories;
+		fNumberOfNonEmptyHistories += result.nonEmptyHistories;
+		fNumberOfParticles += result.particles;
+
+		if (fFirstExcitedIonCode == 0)
+			fFirstExcitedIonCode = result.firstExcitedIonCode;
+
+		if (result.hasRecords)
+			previousChunkEndsWithEmptyHistory = result.endsWithEmptyHistory;
+
+		fChecksum = Hash(reinterpret_cast<const char*>(&result.checksum), sizeof result.checksum, fChecksum);
+	}
+
+	fSampleChecksum = ComputeSampleChecksum();
+}
+
+
+G4bool TsPhaseSpaceIndex::Load(const G4String& indexFileSpec, G4bool verifyChecksum)
+{
+	std::ifstream indexFile(indexFileSpec, std::ios::binary);
+	if (!indexFile || fFileSize < 0)
+		return false;
+
+	char magic[sizeof indexMagic];
+	indexFile.read(magic, sizeof magic);
+	if (!indexFile.good() || std::memcmp(magic, indexMagic, sizeof magic) != 0)
+		return false;
+
+	G4int version, format, recordLength, hasZ, hasWeight, assumePhoton, assumeEvery, assumeFirst;
+	G4long fileSize, fileModificationTime;
+	uint64_t sampleChecksum, checksum;
+	if (!ReadValue(indexFile, version) || version != indexVersion ||
+		!ReadValue(indexFile, format) || format != fDecoder.fFormat ||
+		!ReadValue(indexFile, recordLength) || recordLength != fDecoder.fRecordLength ||
+		!ReadValue(indexFile, hasZ) || hasZ != fDecoder.fLimitedHasZ ||
+		!ReadValue(indexFile, hasWeight) || hasWeight != fDecoder.fLimitedHasWeight ||
+		!ReadValue(indexFile, assumePhoton) || assumePhoton != fDecoder.fLimitedAssumePhotonIsNewHistory ||
+		!ReadValue(indexFile, assumeEvery) || assumeEvery != fDecoder.fLimitedAssumeEveryParticleIsNewHistory ||
+		!ReadValue(indexFile, assumeFirst) || assumeFirst != fDecoder.fLimitedAssumeFirstParticleIsNewHistory ||
+		!ReadValue(indexFile, fileSize) || fileSize != fFileSize ||
+		!ReadValue(indexFile, fileModificationTime) || fileModificationTime != fFileModificationTime ||
+		!ReadValue(indexFile, sampleChecksum) || sampleChecksum != ComputeSampleChecksum() ||
+		!ReadValue(indexFile, checksum))
+		return false;
+
+	G4long nCheckpoints;
+	if (!ReadValue(indexFile, fNumberOfHistories) ||
+		!ReadValue(indexFile, fNumberOfNonEmptyHistories) ||
+		!ReadValue(indexFile, fNumberOfParticles) ||
+		!ReadValue(indexFile, fFirstExcitedIonCode) ||
+		!ReadValue(indexFile, nCheckpoints) || nCheckpoints < 0)
+		return false;
+
+	fCheckpoints.resize(nCheckpoints);
+	if (nCheckpoints > 0) {
+		indexFile.read(reinterpret_cast<char*>(fCheckpoints.data()), nCheckpoints * sizeof(Checkpoint));
+		if (!indexFile.good()) {
+			fCheckpoints.clear();
+			return false;
+		}
+	}
+
+	if (verifyChecksum && checksum != ComputeChecksum()) {
+		fCheckpoints.clear();
+		return false;
+	}
+
+	fChecksum = checksum;
+	fSampleChecksum = sampleChecksum;
+	fProblem = NONE;
+	fProblemPosition = 0;
+	return true;
+}
+
+
+G4bool TsPhaseSpaceIndex::Save(const G4String& indexFileSpec) const
+{
+	if (fProblem != NONE)
+		return false;
+
+	// Write under a private name then rename, so that concurrent jobs never see a partial index
+	G4String temporaryFileSpec = indexFileSpec + "." + std::to_string(getpid()) + ".tmp";
+	std::ofstream indexFile(temporaryFileSpec, std::ios::binary | std::ios::trunc);
+	if (!indexFile)
+		return false;
+
+	indexFile.write(indexMagic, sizeof indexMagic);
+	WriteValue(indexFile, indexVersion);
+	WriteValue(indexFile, G4int(fDecoder.fFormat));
+	WriteValue(indexFile, G4int(fDecoder.fRecordLength));
+	WriteValue(indexFile, G4int(fDecoder.fLimitedHasZ));
+	WriteValue(indexFile, G4int(fDecoder.fLimitedHasWeight));
+	WriteValue(indexFile, G4int(fDecoder.fLimitedAssumePhotonIsNewHistory));
+	WriteValue(indexFile, G4int(fDecoder.fLimitedAssumeEveryParticleIsNewHistory));
+	WriteValue(indexFile, G4int(fDecoder.fLimitedAssumeFirstParticleIsNewHistory));
+	WriteValue(indexFile, fFileSize);
+	WriteValue(indexFile, fFileModificationTime);
+	WriteValue(indexFile, fSampleChecksum);
+	WriteValue(indexFile, fChecksum);
+	WriteValue(indexFile, fNumberOfHistories);
+	WriteValue(indexFile, fNumberOfNonEmptyHistories);
+	WriteValue(indexFile, fNumberOfParticles);
+	WriteValue(indexFile, fFirstExcitedIonCode);
+	WriteValue(indexFile, G4long(fCheckpoints.size()));
+	if (!fCheckpoints.empty())
+		indexFile.write(reinterpret_cast<const char*>(fCheckpoints.data()), fCheckpoints.size() * sizeof(Checkpoint));
+	indexFile.close();
+
+	if (indexFile.fail() || std::rename(temporaryFileSpec.c_str(), indexFileSpec.c_str()) != 0) {
+		std::remove(temporaryFileSpec.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+G4bool TsPhaseSpaceIndex::FindHistory(G4long history, G4bool countEmptyHistories,
+									   G4long& filePosition, G4long& historiesIntoRecord, G4long& recordEnd) const
+{
+	G4long totalHistories = countEmptyHistories ? fNumberOfHistories : fNumberOfNonEmptyHistories;
+	if (history < 0 || history > totalHistories || fFileSize < 0)
+		return false;
+
+	// Last checkpoint at or before the requested history
+	std::vector<Checkpoint>::const_iterator checkpoint =
+		std::upper_bound(fCheckpoints.begin(), fCheckpoints.end(), history,
+						 [countEmptyHistories](G4long value, const Checkpoint& c) {
+							 return value < (countEmptyHistories ? c.histories : c.nonEmptyHistories);
+						 });
+
+	G4long position = 0;
+	G4long count = 0;
+	if (checkpoint != fCheckpoints.begin()) {
+		--checkpoint;
+		position = checkpoint->filePosition;
+		count = countEmptyHistories ? checkpoint->histories : checkpoint->nonEmptyHistories;
+	}
+
+	std::ifstream dataFile(fDataFileSpec, std::ios::binary);
+	if (!dataFile)
+		return false;
+	dataFile.seekg(position);
+
+	G4long endOfData = GetEndOfData(fDataFileSpec, fDecoder);
+	std::vector<char> recordBuffer(fDecoder.fRecordLength);
+	std::string line;
+	TsPhaseSpaceRecord record;
+
+	while (position < endOfData) {
+		G4long nextPosition;
+		if (fDecoder.IsFixedLength()) {
+			dataFile.read(recordBuffer.data(), fDecoder.fRecordLength);
+			if (!dataFile.good())
+				return false;
+			fDecoder.DecodeRecord(recordBuffer.data(), record);
+			nextPosition = position + fDecoder.fRecordLength;
+		} else {
+			std::getline(dataFile, line);
+			if (!dataFile.good() || !fDecoder.DecodeLine(line.data(), line.data() + line.size(), record))
+				return false;
+			nextPosition = position + line.size() + 1;
+		}
+
+		if (position == 0 && fDecoder.fLimitedAssumeFirstParticleIsNewHistory)
+			record.isNewHistory = true;
+
+		if (record.isNewHistory) {
+			G4long historiesInRecord;
+			if (record.weight < 0.)
+				historiesInRecord = countEmptyHistories ? std::lround(-record.weight) : 0;
+			else
+				historiesInRecord = 1;
+
+			if (history < count + historiesInRecord) {
+				filePosition = position;
+				historiesIntoRecord = history - count;
+				recordEnd = nextPosition;
+				return true;
+			}
+			count += historiesInRecord;
+		}
+
+		position = nextPosition;
+	}
+
+	filePosition = position;
+	historiesIntoRecord = 0;
+	recordEnd = position;
+	return history == count;
+}
+
+
+G4long TsPhaseSpaceIndex::GetEndOfData(const G4String& dataFileSpec, const TsPhaseSpaceDecoder& decoder)
+{
+	struct stat stat_buf;
+	if (stat(dataFileSpec.c_str(), &stat_buf) != 0)
+		return 0;
+	G4long fileSize = stat_buf.st_size;
+
+	if (decoder.IsFixedLength())
+		return decoder.fRecordLength > 0 ? (fileSize / decoder.fRecordLength) * decoder.fRecordLength : 0;
+
+	// Search backwards for the final newline
+	std::ifstream dataFile(dataFileSpec, std::ios::binary);
+	std::vector<char> buffer(65536);
+	G4long blockEnd = fileSize;
+	while (blockEnd > 0 && dataFile) {
+		G4long blockStart = std::max(G4long(0), blockEnd - G4long(buffer.size()));
+		dataFile.seekg(blockStart);
+		dataFile.read(buffer.data(), blockEnd - blockStart);
+		for (G4long i = blockEnd - blockStart - 1; i >= 0; i--)
+			if (buffer[i] == '\n')
+				return blockStart + i + 1;
+		blockEnd = blockStart;
+	}
+	return 0;
+}
+
+
+G4long TsPhaseSpaceIndex::GetNumberOfChunks() const
+{
+	if (fFileSize <= 0)
+		return 0;
+
+	if (fDecoder.IsFixedLength()) {
+		if (fDecoder.fRecordLength <= 0)
+			return 0;
+		G4long usableLength = (fFileSize / fDecoder.fRecordLength) * fDecoder.fRecordLength;
+		return (usableLength + fChunkLength - 1) / fChunkLength;
+	}
+
+	return (fFileSize + fChunkLength - 1) / fChunkLength;
+}
+
+
+// Fills buffer with the bytes of one chunk, returning the file position of its first byte.
+// Fixed length chunks hold whole records only.
+// ASCII chunks hold every line that starts within the nominal chunk range, so each line belongs to exactly one chunk.
+G4bool TsPhaseSpaceIndex::ReadChunk(G4long chunk, std::ifstream& dataFile, std::vector<char>& buffer, G4long& chunkStart) const
+{
+	dataFile.clear();
+
+	if (fDecoder.IsFixedLength()) {
+		G4long usableLength = (fFileSize / fDecoder.fRecordLength) * fDecoder.fRecordLength;
+		chunkStart = chunk * fChunkLength;
+		G4long chunkEnd = std::min(chunkStart + fChunkLength, usableLength);
+		buffer.resize(chunkEnd - chunkStart);
+		dataFile.seekg(chunkStart);
+		dataFile.read(buffer.data(), buffer.size());
+		return dataFile.gcount() == G4long(buffer.size());
+	}
+
+	G4long nominalStart = chunk * fChunkLength;
+	G4long nominalEnd = std::min(nominalStart + fChunkLength, fFileSize);
+	G4long readStart = (chunk == 0) ? 0 : nominalStart - 1;
+	buffer.resize(nominalEnd - readStart);
+	dataFile.seekg(readStart);
+	dataFile.read(buffer.data(), buffer.size());
+	if (dataFile.gcount() != G4long(buffer.size()))
+		return false;
+
+	size_t begin = 0;
+	if (chunk > 0) {
+		const char* newline = static_cast<const char*>(std::memchr(buffer.data(), '\n', buffer.size()));
+		if (!newline) {
+			// Entire chunk lies within a line that started in an earlier chunk
+			buffer.clear();
+			chunkStart = nominalEnd;
+			return true;
+		}
+		begin = newline - buffer.data() + 1;
+	}
+
+	// Extend to the end of the line that straddles the nominal chunk end
+	if (nominalEnd < fFileSize && buffer.back() != '\n') {
+		G4long position = nominalEnd;
+		while (position < fFileSize) {
+			size_t oldSize = buffer.size();
+			G4long extra = std::min(G4long(65536), fFileSize - position);
+			buffer.resize(oldSize + extra);
+			dataFile.read(buffer.data() + oldSize, extra);
+			if (dataFile.gcount() != extra)
+				return false;
+			position += extra;
+			const char* newline = static_cast<const char*>(std::memchr(buffer.data() + oldSize, '\n', extra));
+			if (newline) {
+				buffer.resize(newline - buffer.data() + 1);
+				break;
+			}
+		}
+	}
+
+	buffer.erase(buffer.begin(), buffer.begin() + begin);
+	chunkStart = readStart + begin;
+	return true;
+}
+
+
+// Applies the same counting and validation rules as the serial PreCheck, to one chunk.
+void TsPhaseSpaceIndex::ScanChunk(G4long chunk, std::ifstream& dataFile, std::vector<char>& buffer, ChunkResult& result, G4int checkpointStride) const
+{
+	G4long chunkStart = 0;
+	if (!ReadChunk(chunk, dataFile, buffer, chunkStart)) {
+		result.problem = UNREADABLE_FILE;
+		result.problemPosition = chunk * fChunkLength;
+		return;
+	}
+
+	result.checksum = Hash(buffer.data(), buffer.size(), hashOffsetBasis);
+
+	const char* data = buffer.data();
+	const G4long length = buffer.size();
+	G4long offset = 0;
+	G4long historyStarts = 0;
+	G4bool previousHistoryWasEmpty = false;
+	TsPhaseSpaceRecord record;
+
+	while (offset < length) {
+		G4long position = chunkStart + offset;
+
+		if (fDecoder.IsFixedLength()) {
+			fDecoder.DecodeRecord(data + offset, record);
+			offset += fDecoder.fRecordLength;
+		} else {
+			const char* lineEnd = static_cast<const char*>(std::memchr(data + offset, '\n', length - offset));
+			// A final line with no newline is not read, matching the getline based reader
+			if (!lineEnd)
+				break;
+			if (!fDecoder.DecodeLine(data + offset, lineEnd, record)) {
+				result.problem = MALFORMED_LINE;
+				result.problemPosition = position;
+				return;
+			}
+			offset = lineEnd - data + 1;
+		}
+
+		if (position == 0) {
+			if (fDecoder.fLimitedAssumeFirstParticleIsNewHistory)
+				record.isNewHistory = true;
+
+			if (!record.isNewHistory) {
+				result.problem = FIRST_PARTICLE_NOT_NEW_HISTORY;
+				result.problemPosition = position;
+				return;
+			}
+		}
+
+		if (!result.hasRecords) {
+			result.hasRecords = true;
+			result.firstPosition = position;
+			result.firstRecordContinuesHistory = !record.isNewHistory && record.weight >= 0.;
+		}
+
+		if (record.isNewHistory) {
+			if (historyStarts % checkpointStride == 0) {
+				Checkpoint checkpoint = { position, result.histories, result.nonEmptyHistories, result.particles };
+				result.checkpoints.push_back(checkpoint);
+			}
+			historyStarts++;
+		}
+
+		if (record.weight >= 0.)
+			result.particles++;
+
+		if (record.isNewHistory) {
+			if (record.weight < 0.) {
+				previousHistoryWasEmpty = true;
+				result.histories += std::lround(-record.weight);
+			} else {
+				result.histories++;
+				result.nonEmptyHistories++;
+				previousHistoryWasEmpty = false;
+			}
+		} else {
+			if (record.weight < 0.) {
+				result.problem = NEGATIVE_WEIGHT_NOT_NEW_HISTORY;
+				result.problemPosition = position;
+				return;
+			}
+			if (previousHistoryWasEmpty) {
+				result.problem = PARTICLE_AFTER_EMPTY_HISTORY;
+				result.problemPosition = position;
+				return;
+			}
+		}
+
+		if (result.firstExcitedIonCode == 0 && record.particleCode > 999999999 && (record.particleCode % 10) != 0)
+			result.firstExcitedIonCode = record.particleCode;
+	}
+
+	result.endsWithEmptyHistory = previousHistoryWasEmpty;
+}
+
+
+// Runs work on every chunk, spread over the worker threads.
+// The calling thread only waits, reporting progress if requested.
+void TsPhaseSpaceIndex::RunOnChunks(const ChunkWork& work, const std::atomic<G4long>* progress, G4int showProgressAtInterval) const
+{
+	G4long nChunks = GetNumberOfChunks();
+	if (nChunks == 0)
+		return;
+
+	std::atomic<G4long> nextChunk(0);
+	std::atomic<G4int> nFinished(0);
+	G4int nThreads = G4int(std::min(G4long(fNumberOfThreads), nChunks));
+
+	std::vector<std::thread> threads;
+	for (G4int iThread = 0; iThread < nThreads; iThread++) {
+		threads.emplace_back([&]() {
+			std::ifstream dataFile(fDataFileSpec, std::ios::binary);
+			std::vector<char> buffer;
+			for (G4long chunk = nextChunk++; chunk < nChunks; chunk = nextChunk++)
+				work(chunk, dataFile, buffer);
+			nFinished++;
+		});
+	}
+
+	G4long lastReported = 0;
+	while (nFinished < nThreads) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		if (progress && showProgressAtInterval > 0) {
+			G4long reached = (progress->load() / showProgressAtInterval) * showProgressAtInterval;
+			if (reached > lastReported) {
+				G4cout << "PreCheck processing particle: " << reached << G4endl;
+				lastReported = reached;
+			}
+		}
+	}
+
+	for (size_t iThread = 0; iThread < threads.size(); iThread++)
+		threads[iThread].join();
+}
+
+
+uint64_t TsPhaseSpaceIndex::ComputeChecksum() const
+{
+	std::vector<uint64_t> chunkChecksums(GetNumberOfChunks(), 0);
+	std::atomic<G4bool> readFailed(false);
+
+	RunOnChunks([&](G4long chunk, std::ifstream& dataFile, std::vector<char>& buffer) {
+		G4long chunkStart;
+		if (ReadChunk(chunk, dataFile, buffer, chunkStart))
+			chunkChecksums[chunk] = Hash(buffer.data(), buffer.size(), hashOffsetBasis);
+		else
+			readFailed = true;
+	}, 0, 0);
+
+	uint64_t checksum = Hash(reinterpret_cast<const char*>(&fFileSize), sizeof fFileSize, hashOffsetBasis);
+	for (size_t iChunk = 0; iChunk < chunkChecksums.size(); iChunk++)
+		checksum = Hash(reinterpret_cast<const char*>(&chunkChecksums[iChunk]), sizeof(uint64_t), checksum);
+
+	// Flip the result so that a failed read can never match a stored checksum by accident
+	return readFailed ? ~checksum : checksum;
+}
+
+
+// Cheap fingerprint from the start and end of the file, checked every time an index is reused
+uint64_t TsPhaseSpaceIndex::ComputeSampleChecksum() const
+{
+	std::ifstream dataFile(fDataFileSpec, std::ios::binary);
+	if (!dataFile || fFileSize <= 0)
+		return 0;
+
+	G4long length = std::min(sampleLength, fFileSize);
+	std::vector<char> buffer(length);
+	uint64_t checksum = Hash(reinterpret_cast<const char*>(&fFileSize), sizeof fFileSize, hashOffsetBasis);
+
+	dataFile.read(buffer.data(), length);
+	checksum = Hash(buffer.data(), dataFile.gcount(), checksum);
+
+	dataFile.clear();
+	dataFile.seekg(fFileSize - length);
+	dataFile.read(buffer.data(), length);
+	checksum = Hash(buffer.data(), dataFile.gcount(), checksum);
+
+	return checksum;
+}
+
+
+// 64 bit FNV-1a
+uint64_t TsPhaseSpaceIndex::Hash(const char* data, size_t length, uint64_t hash)
+{
+	for (size_t i = 0; i < length; i++) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= hashPrime;
+	}
+	return hash;
+}
@@ -0,0 +1,131 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#ifndef TsPhaseSpaceIndex_hh
+#define TsPhaseSpaceIndex_hh
+
+#include "TsPhaseSpaceDecoder.hh"
+
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <vector>
+#include <stdint.h>
+
+// History index of a phase space data file.
+// Built by scanning the file in parallel chunks, and saved next to the file
+// so that later sessions using the same file can skip the scan.
+class TsPhaseSpaceIndex
+{
+public:
+	// Location of a history-start record, with totals accumulated before that record
+	struct Checkpoint
+	{
+		G4long filePosition;
+		G4long histories;
+		G4long nonEmptyHistories;
+		G4long particles;
+	};
+
+	enum Problem {
+		NONE,
+		UNREADABLE_FILE,
+		FIRST_PARTICLE_NOT_NEW_HISTORY,
+		NEGATIVE_WEIGHT_NOT_NEW_HISTORY,
+		PARTICLE_AFTER_EMPTY_HISTORY,
+		MALFORMED_LINE
+	};
+
+	TsPhaseSpaceIndex(const G4String& dataFileSpec, const TsPhaseSpaceDecoder& decoder, G4int numberOfThreads);
+	~TsPhaseSpaceIndex();
+
+	// Scan the whole data file to count and validate histories.
+	// A checkpoint is stored every checkpointStride history-start records.
+	void Build(G4int checkpointStride, G4int showParticleCountAtInterval);
+
+	// Read a previously saved index. Returns false if it is missing or does not match the data file.
+	G4bool Load(const G4String& indexFileSpec, G4bool verifyChecksum);
+
+	// Returns false if the index could not be written (for example, to a read-only directory)
+	G4bool Save(const G4String& indexFileSpec) const;
+
+	// Locates the record holding the given zero-based history, counting either every history
+	// or only non-empty ones. Starts from the nearest checkpoint, so cost is bounded by the stride.
+	// historiesIntoRecord is non-zero only when a record stands for several empty histories.
+	// Asking for the history one past the last gives the end of the data.
+	G4bool FindHistory(G4long history, G4bool countEmptyHistories,
+					   G4long& filePosition, G4long& historiesIntoRecord, G4long& recordEnd) const;
+
+	// Position just past the last complete record (ASCII lines must end with a newline)
+	static G4long GetEndOfData(const G4String& dataFileSpec, const TsPhaseSpaceDecoder& decoder);
+
+	G4long GetNumberOfHistories() const { return fNumberOfHistories; }
+	G4long GetNumberOfNonEmptyHistories() const { return fNumberOfNonEmptyHistories; }
+	G4long GetNumberOfParticles() const { return fNumberOfParticles; }
+	G4int GetFirstExcitedIonCode() const { return fFirstExcitedIonCode; }
+	Problem GetProblem() const { return fProblem; }
+	G4long GetProblemPosition() const { return fProblemPosition; }
+	uint64_t GetChecksum() const { return fChecksum; }
+	const std::vector<Checkpoint>& GetCheckpoints() const { return fCheckpoints; }
+
+private:
+	struct ChunkResult;
+
+	typedef std::function<void(G4long, std::ifstream&, std::vector<char>&)> ChunkWork;
+
+	G4long GetNumberOfChunks() const;
+	G4bool ReadChunk(G4long chunk, std::ifstream& dataFile, std::vector<char>& buffer, G4long& chunkStart) const;
+	void ScanChunk(G4long chunk, std::ifstream& dataFile, std::vector<char>& buffer, ChunkResult& result, G4int checkpointStride) const;
+	void RunOnChunks(const ChunkWork& work, const std::atomic<G4long>* progress, G4int showProgressAtInterval) const;
+	uint64_t ComputeChecksum() const;
+	uint64_t ComputeSampleChecksum() const;
+
+	static uint64_t Hash(const char* data, size_t length, uint64_t hash);
+
+	G4String fDataFileSpec;
+	TsPhaseSpaceDecoder fDecoder;
+	G4int fNumberOfThreads;
+	G4long fFileSize;
+	G4long fFileModificationTime;
+	G4long fChunkLength;
+
+	G4long fNumberOfHistories;
+	G4long fNumberOfNonEmptyHistories;
+	G4long fNumberOfParticles;
+	G4int fFirstExcitedIonCode;
+	Problem fProblem;
+	G4long fProblemPosition;
+	uint64_t fChecksum;
+	uint64_t fSampleChecksum;
+	std::vector<Checkpoint> fCheckpoints;
+};
+
+#endif
@@ -0,0 +1,203 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#include "TsPhaseSpacePrefetchBuffer.hh"
+
+#include "G4Timer.hh"
+
+#include <sys/stat.h>
+
+TsPhaseSpacePrefetchBuffer::TsPhaseSpacePrefetchBuffer(const G4String& fileSpec, G4long startPosition, G4long blockSize, G4int depth) :
+fFile(fileSpec, std::ios::binary), fIsOpen(false), fFileSize(0), fBlockSize(blockSize), fDepth(depth),
+fNextReadPosition(startPosition), fGeneration(0), fReachedEnd(false), fStop(false), fWaitTime(0.)
+{
+	fIsOpen = fFile.is_open();
+
+	struct stat stat_buf;
+	if (stat(fileSpec.c_str(), &stat_buf) == 0)
+		fFileSize = stat_buf.st_size;
+
+	if (fBlockSize < 1)
+		fBlockSize = 1;
+	if (fDepth < 1)
+		fDepth = 1;
+
+	fCurrent.position = startPosition;
+	setg(0, 0, 0);
+
+	if (fIsOpen)
+		fThread = std::thread(&TsPhaseSpacePrefetchBuffer::ReadAhead, this);
+}
+
+
+TsPhaseSpacePrefetchBuffer::~TsPhaseSpacePrefetchBuffer()
+{
+	{
+		std::lock_guard<std::mutex> lock(fMutex);
+		fStop = true;
+	}
+	fCondition.notify_all();
+
+	if (fThread.joinable())
+		fThread.join();
+}
+
+
+G4double TsPhaseSpacePrefetchBuffer::GetAndResetWaitTime()
+{
+	G4double waitTime = fWaitTime;
+	fWaitTime = 0.;
+	return waitTime;
+}
+
+
+// Background thread: keep reading blocks until depth blocks are waiting or the file ends.
+// A block read while a seek was requested belongs to the old position and is dropped.
+void TsPhaseSpacePrefetchBuffer::ReadAhead()
+{
+	std::unique_lock<std::mutex> lock(fMutex);
+
+	while (true) {
+		fCondition.wait(lock, [this] { return fStop || (fReady.size() < fDepth && !fReachedEnd); });
+		if (fStop)
+			return;
+
+		G4long generation = fGeneration;
+		Block block;
+		block.position = fNextReadPosition;
+		lock.unlock();
+
+		block.data.resize(fBlockSize);
+		fFile.clear();
+		fFile.seekg(block.position);
+		fFile.read(block.data.data(), fBlockSize);
+		block.data.resize(fFile.gcount());
+
+		lock.lock();
+		if (generation != fGeneration)
+			continue;
+
+		fNextReadPosition = block.position + block.data.size();
+		// An empty block marks the end of the file
+		if (block.data.empty())
+			fReachedEnd = true;
+		fReady.push_back(std::move(block));
+		fCondition.notify_all();
+	}
+}
+
+
+void TsPhaseSpacePrefetchBuffer::RestartAt(G4long position)
+{
+	{
+		std::lock_guard<std::mutex> lock(fMutex);
+		fGeneration++;
+		fReady.clear();
+		fNextReadPosition = position;
+		fReachedEnd = false;
+	}
+	fCondition.notify_all();
+
+	fCurrent.position = position;
+	fCurrent.data.clear();
+	setg(0, 0, 0);
+}
+
+
+TsPhaseSpacePrefetchBuffer::int_type TsPhaseSpacePrefetchBuffer::underflow()
+{
+	if (gptr() < egptr())
+		return traits_type::to_int_type(*gptr());
+
+	if (!fIsOpen)
+		return traits_type::eof();
+
+	Block next;
+	{
+		std::unique_lock<std::mutex> lock(fMutex);
+		if (fReady.empty()) {
+			G4Timer timer;
+			timer.Start();
+			fCondition.wait(lock, [this] { return !fReady.empty(); });
+			timer.Stop();
+			fWaitTime += timer.GetRealElapsed();
+		}
+
+		// Leave the end of file marker in place, so that later reads also see the end
+		if (fReady.front().data.empty())
+			return traits_type::eof();
+
+		next = std::move(fReady.front());
+		fReady.pop_front();
+	}
+	fCondition.notify_all();
+
+	fCurrent = std::move(next);
+	char* begin = fCurrent.data.data();
+	setg(begin, begin, begin + fCurrent.data.size());
+	return traits_type::to_int_type(*gptr());
+}
+
+
+TsPhaseSpacePrefetchBuffer::pos_type TsPhaseSpacePrefetchBuffer::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode)
+{
+	G4long position;
+	if (direction == std::ios_base::beg)
+		position = offset;
+	else if (direction == std::ios_base::cur)
+		position = fCurrent.position + (gptr() - eback()) + offset;
+	else
+		position = fFileSize + offset;
+
+	return seekpos(pos_type(off_type(position)), mode);
+}
+
+
+TsPhaseSpacePrefetchBuffer::pos_type TsPhaseSpacePrefetchBuffer::seekpos(pos_type position, std::ios_base::openmode mode)
+{
+	if (!(mode & std::ios_base::in) || !fIsOpen)
+		return pos_type(off_type(-1));
+
+	G4long target = off_type(position);
+	if (target < 0 || target > fFileSize)
+		return pos_type(off_type(-1));
+
+	// Stay within the current block when we can, so that sequential reading never restarts read-ahead
+	G4long currentEnd = fCurrent.position + fCurrent.data.size();
+	if (target >= fCurrent.position && target <= currentEnd) {
+		char* begin = fCurrent.data.data();
+		setg(begin, begin + (target - fCurrent.position), begin + fCurrent.data.size());
+	} else {
+		RestartAt(target);
+	}
+
+	return position;
+}
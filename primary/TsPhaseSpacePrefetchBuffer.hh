@@ -0,0 +1,94 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#ifndef TsPhaseSpacePrefetchBuffer_hh
+#define TsPhaseSpacePrefetchBuffer_hh
+
+#include "globals.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+// Input stream buffer over a phase space data file, filled ahead of use by a background thread.
+// The reader thread keeps up to depth blocks ready in memory, so that parsing of the current block
+// overlaps with reading of the following ones. Any seek outside the current block restarts read-ahead
+// at the new position. Consumers must serialize access to the buffer themselves.
+class TsPhaseSpacePrefetchBuffer : public std::streambuf
+{
+public:
+	TsPhaseSpacePrefetchBuffer(const G4String& fileSpec, G4long startPosition, G4long blockSize, G4int depth);
+	~TsPhaseSpacePrefetchBuffer();
+
+	G4bool IsOpen() const { return fIsOpen; }
+
+	// Real time consumers spent waiting for blocks that were not yet read, since last call
+	G4double GetAndResetWaitTime();
+
+protected:
+	int_type underflow();
+	pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode);
+	pos_type seekpos(pos_type position, std::ios_base::openmode mode);
+
+private:
+	struct Block
+	{
+		G4long position;
+		std::vector<char> data;
+	};
+
+	void ReadAhead();
+	void RestartAt(G4long position);
+
+	std::ifstream fFile;
+	G4bool fIsOpen;
+	G4long fFileSize;
+	G4long fBlockSize;
+	size_t fDepth;
+
+	std::thread fThread;
+	std::mutex fMutex;
+	std::condition_variable fCondition;
+	std::deque<Block> fReady;
+	G4long fNextReadPosition;
+	G4long fGeneration;
+	G4bool fReachedEnd;
+	G4bool fStop;
+
+	Block fCurrent;
+	G4double fWaitTime;
+};
+
+#endif
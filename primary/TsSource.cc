@@ -123,6 +123,13 @@ G4bool TsSource::RandomModeNeedsMoreRuns() {
 }
 
 
+G4long TsSource::GetNumberOfHistoriesStillNeededInRandomJob() {
+	if (fTotalHistoriesGenerated >= fNumberOfHistoriesInRandomJob)
+		return 0;
+	return fNumberOfHistoriesInRandomJob - fTotalHistoriesGenerated;
+}
+
+
 G4int TsSource::GetNumberOfHistoriesInRun() {
 	return fNumberOfHistoriesInRun;
 }
@@ -74,6 +74,7 @@ public:
 	G4long GetNumberOfHistoriesInRandomJob();
 	G4double GetProbabilityOfUsingAGivenRandomTime();
 	G4bool RandomModeNeedsMoreRuns();
+	G4long GetNumberOfHistoriesStillNeededInRandomJob();
 
 	void NoteNumberOfHistoriesGenerated(G4int number);
 	void NoteNumberOfParticlesGenerated(G4long number);
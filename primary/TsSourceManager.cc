@@ -120,7 +120,8 @@ void TsSourceManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 		G4String nameToLower = name;
 		G4StrUtil::to_lower(nameToLower);
 		std::multimap< G4String, std::pair<TsSource*,G4String> >::const_iterator iter;
-		for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end() && !matched; iter++) {
+		std::multimap< G4String, std::pair<TsSource*,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(nameToLower);
+		for (iter = fChangeableParameterMap.lower_bound(nameToLower); iter != last && !matched; iter++) {
 			G4String gotParm = iter->first;
 			TsSource* gotSource = iter->second.first;
 			G4String gotDirectParm = iter->second.second;
@@ -130,6 +131,7 @@ void TsSourceManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 		if (!matched) {
 			fChangeableParameterMap.insert(std::make_pair(nameToLower, std::make_pair(fCurrentSource, directParm)));
+			fPm->RegisterParameterConsumer(name, "source", fCurrentSource->GetName(), directParm);
 			if (fPm->IGetIntegerParameter("Tf/Verbosity") > 0)
 				G4cout << "Registered use of changeable parameter: " << name << "  by source: " << fCurrentSource->GetName() << G4endl;
 		}
@@ -170,7 +172,8 @@ void TsSourceManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 void TsSourceManager::UpdateForSpecificParameterChange(G4String parameter) {
 	if (fSqm) {
 		std::multimap< G4String, std::pair<TsSource*,G4String> >::const_iterator iter;
-		for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end(); iter++) {
+		std::multimap< G4String, std::pair<TsSource*,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(parameter);
+		for (iter = fChangeableParameterMap.lower_bound(parameter); iter != last; iter++) {
 			if (iter->first==parameter) {
 				G4String directParameterName = iter->second.second;
 				if (fVerbosity>0)
@@ -253,6 +256,17 @@ G4bool TsSourceManager::RandomModeNeedsMoreRuns() {
 }
 
 
+G4long TsSourceManager::GetNumberOfHistoriesStillNeededInRandomJob() {
+	G4long maxNumber = 0;
+	std::map<G4String, TsSource*>::const_iterator iter;
+	for (iter=fSources->begin(); iter!=fSources->end(); iter++)
+		if (iter->second->GetNumberOfHistoriesStillNeededInRandomJob() > maxNumber)
+			maxNumber = iter->second->GetNumberOfHistoriesStillNeededInRandomJob();
+
+	return maxNumber;
+}
+
+
 G4int TsSourceManager::GetNumberOfHistoriesInRun() {
 	G4int maxNumber = 0;
 	G4int number;
@@ -267,6 +281,16 @@ G4int TsSourceManager::GetNumberOfHistoriesInRun() {
 }
 
 
+std::map<G4String, G4int> TsSourceManager::GetNumberOfHistoriesInRunPerSource() {
+	std::map<G4String, G4int> numbers;
+	std::map<G4String, TsSource*>::const_iterator iter;
+	for (iter=fSources->begin(); iter!=fSources->end(); iter++)
+		numbers[iter->second->GetName()] = iter->second->GetNumberOfHistoriesInRun();
+
+	return numbers;
+}
+
+
 void TsSourceManager::AddSourceFromGUI(G4String& sourceName, G4String& componentName, G4String& typeName) {
 	G4String parameterName;
 	G4String transValue;
@@ -64,8 +64,10 @@ public:
 	TsGeometryManager* GetGeometryManager();
 
 	G4bool RandomModeNeedsMoreRuns();
+	G4long GetNumberOfHistoriesStillNeededInRandomJob();
 
 	G4int GetNumberOfHistoriesInRun();
+	std::map<G4String, G4int> GetNumberOfHistoriesInRunPerSource();
 
 	void AddSourceFromGUI(G4String& sourceName, G4String& componentName, G4String& typeName);
 
@@ -31,11 +31,14 @@
 #include "TsSourcePhaseSpace.hh"
 
 #include "TsParameterManager.hh"
+#include "TsPhaseSpaceIndex.hh"
+#include "TsPhaseSpacePrefetchBuffer.hh"
 
 #include "TsTopasConfig.hh"
 
 #include "G4UIcommand.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Timer.hh"
 
 #include <fstream>
 #include <sys/stat.h>
@@ -52,9 +55,13 @@ namespace {
 
 TsSourcePhaseSpace::TsSourcePhaseSpace(TsParameterManager* pM, TsSourceManager* psM, G4String sourceName) :
 TsSource(pM, psM, sourceName),
-fRecordLength(0), fFileSize(0), fFilePosition(0), fAsciiLine(""), fIgnoreUnsupportedParticles(false),
+fRecordLength(0), fFileSize(0), fDataStream(0), fPrefetchBuffer(0), fPrefetchStream(0), fPrefetchDepth(0),
+fPrefetchBlockSize(4096), fStallTime(0.), fPrefetchWaitTime(0.), fNumberOfRefills(0),
+fFilePosition(0), fDataStartPosition(0), fDataEndPosition(0), fLastRecordStart(0),
+fRangeStartSkip(0), fRangeEndRecordPosition(0), fRangeEndKeep(0), fRangeNumberOfHistories(0),
+fAsciiLine(""), fIndex(0), fIgnoreUnsupportedParticles(false),
 fIncludeEmptyHistories(false), fNumberOfEmptyHistoriesToAppend(0), fNumberOfEmptyHistoriesAppended(0),
-fPreviousHistoryWasEmpty(false), fMultipleUse(1),
+fMultipleUse(1),
 fIsBinary(false), fIsLimited(false), fLimitedHasZ(true), fLimitedHasWeight(true),
 fLimitedAssumePhotonIsNewHistory(false), fLimitedAssumeEveryParticleIsNewHistory(false),
 fLimitedAssumeFirstParticleIsNewHistory(false),
@@ -199,6 +206,27 @@ fPhaseSpaceInvertXAxis(false), fPhaseSpaceInvertYAxis(false), fPhaseSpaceInvertZ
 		headerFile.close();
 	}
 
+	if (fIsLimited)
+		fDecoder.fFormat = TsPhaseSpaceDecoder::LIMITED;
+	else if (fIsBinary)
+		fDecoder.fFormat = TsPhaseSpaceDecoder::BINARY;
+	else
+		fDecoder.fFormat = TsPhaseSpaceDecoder::ASCII;
+	fDecoder.fRecordLength = fRecordLength;
+	fDecoder.fLimitedHasZ = fLimitedHasZ;
+	fDecoder.fLimitedHasWeight = fLimitedHasWeight;
+	fDecoder.fLimitedAssumePhotonIsNewHistory = fLimitedAssumePhotonIsNewHistory;
+	fDecoder.fLimitedAssumeEveryParticleIsNewHistory = fLimitedAssumeEveryParticleIsNewHistory;
+	fDecoder.fLimitedAssumeFirstParticleIsNewHistory = fLimitedAssumeFirstParticleIsNewHistory;
+
+	if (fDecoder.IsFixedLength() && fRecordLength < fDecoder.GetMinimumRecordLength()) {
+		G4cerr << "TOPAS is quitting due to a serious error in specification of particle source: " << GetName() << G4endl;
+		G4cerr << "Phase Space header gives a record length of " << fRecordLength << " bytes," << G4endl;
+		G4cerr << "but the columns stored in this format need at least " << fDecoder.GetMinimumRecordLength() << " bytes." << G4endl;
+		fPm->AbortSession(1);
+	}
+	fRecordBuffer.resize(fRecordLength);
+
     G4String dataFileSpec = fFileName+".phsp";
     fFileSize = GetFileSize(dataFileSpec);
 
@@ -217,11 +245,28 @@ fPhaseSpaceInvertXAxis(false), fPhaseSpaceInvertYAxis(false), fPhaseSpaceInvertZ
 	if (fPm->ParameterExists(GetFullParmName("PhaseSpaceIncludeEmptyHistories")))
 		fIncludeEmptyHistories = fPm->GetBooleanParameter(GetFullParmName("PhaseSpaceIncludeEmptyHistories"));
 
+	if (fPm->ParameterExists(GetFullParmName("PhaseSpacePrefetchDepth")))
+		fPrefetchDepth = fPm->GetIntegerParameter(GetFullParmName("PhaseSpacePrefetchDepth"));
+
+	if (fPm->ParameterExists(GetFullParmName("PhaseSpacePrefetchBlockSize")))
+		fPrefetchBlockSize = fPm->GetIntegerParameter(GetFullParmName("PhaseSpacePrefetchBlockSize"));
+
+	if (fPrefetchDepth < 0) {
+		G4cerr << "Topas is exiting due to a serious error in source: " << GetName() << G4endl;
+		G4cerr << "Negative values are not allowed for the parameter: " << GetFullParmName("PhaseSpacePrefetchDepth") << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	if (fPrefetchBlockSize <= 0) {
+		G4cerr << "Topas is exiting due to a serious error in source: " << GetName() << G4endl;
+		G4cerr << GetFullParmName("PhaseSpacePrefetchBlockSize") << " must be greater than zero." << G4endl;
+		fPm->AbortSession(1);
+	}
+
 	if (fPreCheck) {
         G4cout << "Phase Space Reader performing PreCheck on file: " << fFileName << G4endl;
 
-        // Null buffer is signal to method that we are doing PreCheck
-		ReadSomeDataFromFileToBuffer(NULL);
+		PreCheck();
 
         // Limited format header does not provide number of non-empty histories. So get from PreCheck.
         if (fIsLimited)
@@ -278,12 +323,212 @@ fPhaseSpaceInvertXAxis(false), fPhaseSpaceInvertYAxis(false), fPhaseSpaceInvertZ
 			fHeaderNumberOfNonEmptyHistories = fHeaderNumberOfHistories;
 	}
 
+	fDataEndPosition = TsPhaseSpaceIndex::GetEndOfData(dataFileSpec, fDecoder);
+
+	if (fPm->ParameterExists(GetFullParmName("PhaseSpaceStartHistory")) ||
+		fPm->ParameterExists(GetFullParmName("PhaseSpaceHistoryCount")))
+		SetUpHistoryRange();
+
+	// Last position at which a complete record can still start
+	fLastRecordStart = fDataEndPosition - (fDecoder.IsFixedLength() ? fRecordLength : 1);
+	fFilePosition = fDataStartPosition;
+
 	ResolveParameters();
 }
 
 
 TsSourcePhaseSpace::~TsSourcePhaseSpace()
 {
+	delete fPrefetchStream;
+	delete fPrefetchBuffer;
+	delete fIndex;
+}
+
+
+// Counts and validates histories by scanning the data file in parallel chunks,
+// or reuses the history index left next to the data file by an earlier session.
+void TsSourcePhaseSpace::PreCheck()
+{
+	G4String dataFileSpec = fFileName+".phsp";
+
+	G4int nThreads = 0;
+	if (fPm->ParameterExists(GetFullParmName("PhaseSpacePreCheckThreads")))
+		nThreads = fPm->GetIntegerParameter(GetFullParmName("PhaseSpacePreCheckThreads"));
+
+	G4bool useIndex = true;
+	if (fPm->ParameterExists(GetFullParmName("PhaseSpaceUseIndex")))
+		useIndex = fPm->GetBooleanParameter(GetFullParmName("PhaseSpaceUseIndex"));
+
+	G4String indexFileSpec = fFileName+".phspindex";
+	if (fPm->ParameterExists(GetFullParmName("PhaseSpaceIndexFileName")))
+		indexFileSpec = fPm->GetStringParameter(GetFullParmName("PhaseSpaceIndexFileName"));
+
+	G4bool verifyChecksum = false;
+	if (fPm->ParameterExists(GetFullParmName("PhaseSpaceIndexVerifyChecksum")))
+		verifyChecksum = fPm->GetBooleanParameter(GetFullParmName("PhaseSpaceIndexVerifyChecksum"));
+
+	G4int checkpointStride = 1000;
+	if (fPm->ParameterExists(GetFullParmName("PhaseSpaceIndexStride"))) {
+		checkpointStride = fPm->GetIntegerParameter(GetFullParmName("PhaseSpaceIndexStride"));
+		if (checkpointStride < 1) {
+			G4cerr << "TOPAS is quitting due to a serious error in specification of particle source: " << GetName() << G4endl;
+			G4cerr << GetFullParmName("PhaseSpaceIndexStride") << " must be greater than zero." << G4endl;
+			fPm->AbortSession(1);
+		}
+	}
+
+	fIndex = new TsPhaseSpaceIndex(dataFileSpec, fDecoder, nThreads);
+
+	if (useIndex && fIndex->Load(indexFileSpec, verifyChecksum)) {
+		G4cout << "Phase Space Reader reusing history index: " << indexFileSpec << G4endl;
+	} else {
+		fIndex->Build(checkpointStride, fPreCheckShowParticleCountAtInterval);
+		ReportPreCheckProblem();
+
+		if (useIndex) {
+			if (fIndex->Save(indexFileSpec))
+				G4cout << "Phase Space Reader wrote history index: " << indexFileSpec << G4endl;
+			else
+				G4cout << "Note: Phase Space Reader was unable to write history index: " << indexFileSpec << G4endl;
+		}
+	}
+
+	fPreCheckNumberOfHistories = fIndex->GetNumberOfHistories();
+	fPreCheckNumberOfNonEmptyHistories = fIndex->GetNumberOfNonEmptyHistories();
+	fPreCheckNumberOfParticles = fIndex->GetNumberOfParticles();
+
+	if (fIndex->GetFirstExcitedIonCode() != 0 && !fPm->GetBooleanParameter("Ts/TreatExcitedIonsAsGroundState"))
+	{
+		G4cerr << "A phase space input file or filter parameter is using a PDG" << G4endl;
+		G4cerr << "particle code that corresponds to an ion in an excited state." << G4endl;
+		G4cerr << "This is any ten digit PDG code that does not end in a zero." << G4endl;
+		G4cerr << "The PDG code seen here was: " << fIndex->GetFirstExcitedIonCode() << G4endl;
+		G4cerr << "TOPAS can only handle such ions by treating them as ground state." << G4endl;
+		G4cerr << "To accept this compromise, set" << G4endl;
+		G4cerr << "Ts/TreatExcitedIonsAsGroundState to True." << G4endl;
+		fPm->AbortSession(1);
+	}
+}
+
+
+// Restricts reading to a contiguous range of histories, located through the history index,
+// so that independent jobs can each take their own share of one phase space file.
+void TsSourcePhaseSpace::SetUpHistoryRange()
+{
+	if (!fIndex) {
+		G4cerr << "TOPAS is quitting due to a serious error in specification of particle source: " << GetName() << G4endl;
+		G4cerr << "PhaseSpaceStartHistory and PhaseSpaceHistoryCount need PhaseSpacePreCheck," << G4endl;
+		G4cerr << "since TOPAS locates the requested histories through the PreCheck history index." << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	if (fNumberOfEmptyHistoriesToAppend > 0) {
+		G4cerr << "TOPAS is quitting due to a serious error in specification of particle source: " << GetName() << G4endl;
+		G4cerr << "PhaseSpaceStartHistory and PhaseSpaceHistoryCount can not be used when empty histories" << G4endl;
+		G4cerr << "are to be appended at the end of the file read, since their place in the sequence is unknown." << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	G4long totalHistories = fIncludeEmptyHistories ? fPreCheckNumberOfHistories : fPreCheckNumberOfNonEmptyHistories;
+
+	G4long startHistory = 0;
+	if (fPm->ParameterExists(GetFullParmName("PhaseSpaceStartHistory")))
+		startHistory = fPm->GetIntegerParameter(GetFullParmName("PhaseSpaceStartHistory"));
+
+	G4long historyCount = totalHistories - startHistory;
+	if (fPm->ParameterExists(GetFullParmName("PhaseSpaceHistoryCount")))
+		historyCount = fPm->GetIntegerParameter(GetFullParmName("PhaseSpaceHistoryCount"));
+
+	if (startHistory < 0 || startHistory >= totalHistories || historyCount < 1 || startHistory + historyCount > totalHistories) {
+		G4cerr << "TOPAS is quitting due to a serious error in specification of particle source: " << GetName() << G4endl;
+		G4cerr << "PhaseSpaceStartHistory: " << startHistory << " and PhaseSpaceHistoryCount: " << historyCount << G4endl;
+		G4cerr << "do not describe a range within the " << totalHistories << " histories of the phase space file." << G4endl;
+		G4cerr << "Histories are counted from zero";
+		if (fIncludeEmptyHistories)
+			G4cerr << ", including empty histories." << G4endl;
+		else
+			G4cerr << ", not counting empty histories." << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	G4long recordEnd;
+	if (!fIndex->FindHistory(startHistory, fIncludeEmptyHistories, fDataStartPosition, fRangeStartSkip, recordEnd)) {
+		G4cerr << "TOPAS is quitting due to an error reading phase space file: " << fFileName+".phsp" << G4endl;
+		G4cerr << "Unable to locate history: " << startHistory << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	G4long endSkip;
+	if (!fIndex->FindHistory(startHistory + historyCount, fIncludeEmptyHistories, fRangeEndRecordPosition, endSkip, recordEnd)) {
+		G4cerr << "TOPAS is quitting due to an error reading phase space file: " << fFileName+".phsp" << G4endl;
+		G4cerr << "Unable to locate history: " << startHistory + historyCount << G4endl;
+		fPm->AbortSession(1);
+	}
+
+	// The range may end part way through a record that stands for several empty histories.
+	// That record is then read, but only for the histories that fall within the range.
+	if (endSkip > 0) {
+		fRangeEndKeep = endSkip;
+		fDataEndPosition = recordEnd;
+	} else {
+		fDataEndPosition = fRangeEndRecordPosition;
+	}
+
+	fRangeNumberOfHistories = historyCount;
+
+	G4cout << "Phase Space Reader will use " << historyCount << " histories starting from history " << startHistory
+		<< " (file positions " << fDataStartPosition << " to " << fDataEndPosition << ")." << G4endl;
+}
+
+
+void TsSourcePhaseSpace::ReportPreCheckProblem()
+{
+	G4String dataFileSpec = fFileName+".phsp";
+
+	switch (fIndex->GetProblem())
+	{
+		case TsPhaseSpaceIndex::NONE:
+			return;
+		case TsPhaseSpaceIndex::UNREADABLE_FILE:
+			G4cerr << "Error opening phase space data file:" << dataFileSpec << G4endl;
+			break;
+		case TsPhaseSpaceIndex::FIRST_PARTICLE_NOT_NEW_HISTORY:
+			ReportFirstParticleNotNewHistory(dataFileSpec);
+			break;
+		case TsPhaseSpaceIndex::NEGATIVE_WEIGHT_NOT_NEW_HISTORY:
+			G4cerr << "Error reading phase space file." << G4endl;
+			G4cerr << "A particle has been read with a negative weight but no IsNewHistory flag." << G4endl;
+			G4cerr << "Negative weight is used to represent one or more empty histories," << G4endl;
+			G4cerr << "so must always have the IsNewHistory flag." << G4endl;
+			break;
+		case TsPhaseSpaceIndex::PARTICLE_AFTER_EMPTY_HISTORY:
+			G4cerr << "Error reading phase space file." << G4endl;
+			G4cerr << "Read a particle that does not have the IsNewHistory flag" << G4endl;
+			G4cerr << "right after reading an empty history. This does not make sense." << G4endl;
+			break;
+		case TsPhaseSpaceIndex::MALFORMED_LINE:
+			G4cerr << "Error reading phase space file." << G4endl;
+			G4cerr << "A line does not hold the ten columns expected in TOPAS ASCII format." << G4endl;
+			break;
+	}
+
+	G4cerr << "Problem found at file position: " << fIndex->GetProblemPosition() << G4endl;
+	fPm->AbortSession(1);
+}
+
+
+void TsSourcePhaseSpace::ReportFirstParticleNotNewHistory(const G4String& dataFileSpec)
+{
+	G4cerr << "Error in phase space file: " << dataFileSpec << "." << G4endl;
+	G4cerr << "First particle does not have the New History flag set." << G4endl;
+	G4cerr << "We believe this should be forbidden in the Limited format," << G4endl;
+	G4cerr << "but we have seen some files that do not have any New History flags." << G4endl;
+	G4cerr << "We recommend against using this file." << G4endl;
+	G4cerr << "But, depending what is really wrong with the file," << G4endl;
+	G4cerr << "you may be able to get it to work by setting one or more of the following:" << G4endl;
+	G4cerr << "b:So/" << GetName() << "/LimitedAssumeFirstParticleIsNewHistory = \"True\"" << G4endl;
+	G4cerr << "b:So/" << GetName() << "/LimitedAssumeEveryParticleIsNewHistory = \"True\"" << G4endl;
+	G4cerr << "b:So/" << GetName() << "/LimitedAssumePhotonIsNewHistory = \"True\"" << G4endl;
 }
 
 
@@ -358,7 +603,9 @@ void TsSourcePhaseSpace::ResolveParameters() {
 
 	// fNumberOfHistoriesInRun is the number of times we want this source to be called.
 	if (fMultipleUse > 0) {
-		if (fIncludeEmptyHistories)
+		if (fRangeNumberOfHistories > 0)
+			fNumberOfHistoriesInRun = fRangeNumberOfHistories * fMultipleUse;
+		else if (fIncludeEmptyHistories)
 			fNumberOfHistoriesInRun = fHeaderNumberOfHistories * fMultipleUse;
 		else
 			fNumberOfHistoriesInRun = fHeaderNumberOfNonEmptyHistories * fMultipleUse;
@@ -389,74 +636,101 @@ void TsSourcePhaseSpace::ResolveParameters() {
 }
 
 
+void TsSourcePhaseSpace::UpdateForEndOfRun()
+{
+	if (fNumberOfRefills > 0) {
+		G4cout << "\nPhase space source: " << GetName() << G4endl;
+		G4cout << "Worker threads refilled their particle buffers " << fNumberOfRefills << " times" << G4endl;
+		G4cout << "Total worker stall time waiting for phase space data: " << fStallTime << " s" << G4endl;
+		if (fPrefetchDepth > 0)
+			G4cout << "of which waiting for the prefetch thread to read from disk: " << fPrefetchWaitTime << " s" << G4endl;
+	}
+
+	fStallTime = 0.;
+	fPrefetchWaitTime = 0.;
+	fNumberOfRefills = 0;
+}
+
+
 void TsSourcePhaseSpace::ReadSomeDataFromFileToBuffer(std::queue<TsPrimaryParticle>* particleBuffer)
 {
+	// Stall time covers waiting for other threads to finish their refills as well as our own reading
+	G4Timer stallTimer;
+	stallTimer.Start();
+
 #ifdef TOPAS_MT
     G4AutoLock l(&readSomeDataMutex);
 #endif
 
     G4String dataFileSpec = fFileName+".phsp";
-    fDataFile.open(dataFileSpec);
-    if (!fDataFile) {
-        G4cerr << "Error opening phase space data file:" << dataFileSpec << G4endl;
-        fPm->AbortSession(1);
-    }
+	if (fPrefetchDepth > 0) {
+		// Background thread reads blocks of the file ahead, independent of the eventModulo buffer size
+		if (!fPrefetchBuffer) {
+			fPrefetchBuffer = new TsPhaseSpacePrefetchBuffer(dataFileSpec, fDataStartPosition, fPrefetchBlockSize * 1024, fPrefetchDepth);
+			fPrefetchStream = new std::istream(fPrefetchBuffer);
+		}
+		if (!fPrefetchBuffer->IsOpen()) {
+			G4cerr << "Error opening phase space data file:" << dataFileSpec << G4endl;
+			fPm->AbortSession(1);
+		}
+		fPrefetchStream->clear();
+		fDataStream = fPrefetchStream;
+	} else {
+		fDataFile.open(dataFileSpec);
+		if (!fDataFile) {
+			G4cerr << "Error opening phase space data file:" << dataFileSpec << G4endl;
+			fPm->AbortSession(1);
+		}
+		fDataStream = &fDataFile;
+	}
 
-    // Read one particle if this is the first read from the file.
+    // Read one particle if this is the first read from the file (or from the requested history range).
     // Otherwise, we will already have one left over from last read operation.
-    if (fFilePosition == 0) {
-        ReadOneParticle(particleBuffer);
-		if (fLimitedAssumeFirstParticleIsNewHistory)
+    if (fFilePosition == fDataStartPosition) {
+        fDataStream->seekg(fDataStartPosition);
+        ReadOneParticle();
+		if (fLimitedAssumeFirstParticleIsNewHistory && fDataStartPosition == 0)
 			fPrimaryParticle.isNewHistory = true;
+
+		// Skip the empty histories of the first record that fall before the requested range
+		if (fRangeStartSkip > 0)
+			fPrimaryParticle.weight += fRangeStartSkip;
     } else {
         // Advance the seek pointer to next unread position in the file
-        fDataFile.seekg(fFilePosition);
+        fDataStream->seekg(fFilePosition);
     }
 
-    if (!fDataFile.good()) {
+    if (!fDataStream->good()) {
         G4cerr << "Problem after attempt to seek file position: " << fFilePosition << G4endl;
         fPm->AbortSession(1);
     }
 
     if (!fPrimaryParticle.isNewHistory) {
-        G4cerr << "Error in phase space file: " << dataFileSpec << "." << G4endl;
-        G4cerr << "First particle does not have the New History flag set." << G4endl;
-		G4cerr << "We believe this should be forbidden in the Limited format," << G4endl;
-		G4cerr << "but we have seen some files that do not have any New History flags." << G4endl;
-		G4cerr << "We recommend against using this file." << G4endl;
-		G4cerr << "But, depending what is really wrong with the file," << G4endl;
-		G4cerr << "you may be able to get it to work by setting one or more of the following:" << G4endl;
-		G4cerr << "b:So/" << GetName() << "/LimitedAssumeFirstParticleIsNewHistory = \"True\"" << G4endl;
-		G4cerr << "b:So/" << GetName() << "/LimitedAssumeEveryParticleIsNewHistory = \"True\"" << G4endl;
-		G4cerr << "b:So/" << GetName() << "/LimitedAssumePhotonIsNewHistory = \"True\"" << G4endl;
+		ReportFirstParticleNotNewHistory(dataFileSpec);
         fPm->AbortSession(1);
     }
 
-    // Read entire file if just doing precheck. Otherwise read eventModulo histories.
+    // Read eventModulo histories.
     G4int bufferSize;
-    if (particleBuffer) {
 #ifdef TOPAS_MT
-		if (G4MTRunManager::GetMasterRunManager()->GetNumberOfThreads() == 1)
-			bufferSize = 10000;
-		else
-			bufferSize = G4MTRunManager::GetMasterRunManager()->GetEventModulo();
-#else
+	if (G4MTRunManager::GetMasterRunManager()->GetNumberOfThreads() == 1)
 		bufferSize = 10000;
+	else
+		bufferSize = G4MTRunManager::GetMasterRunManager()->GetEventModulo();
+#else
+	bufferSize = 10000;
 #endif
-    } else {
-        bufferSize = INT_MAX;
-    }
 
     G4int nHistoriesRead = 1;
 
     while ((nHistoriesRead <= bufferSize) &&
-		   ((fDataFile.tellg() != -1) && ((fDataFile.tellg() <= (fFileSize-fRecordLength)) || (fNumberOfEmptyHistoriesAppended < fNumberOfEmptyHistoriesToAppend)))) {
+		   ((fDataStream->tellg() != -1) && ((fDataStream->tellg() <= fLastRecordStart) || (fNumberOfEmptyHistoriesAppended < fNumberOfEmptyHistoriesToAppend)))) {
         // Store particle to the buffer
-        if (particleBuffer && (fIncludeEmptyHistories || fPrimaryParticle.particleDefinition != 0))
+        if (fIncludeEmptyHistories || fPrimaryParticle.particleDefinition != 0)
             particleBuffer->push(fPrimaryParticle);
 
 		G4bool FileIsEmpty = false;
-		if ((fDataFile.tellg() != -1) && (fDataFile.tellg() <= (fFileSize-fRecordLength))) {
+		if ((fDataStream->tellg() != -1) && (fDataStream->tellg() <= fLastRecordStart)) {
 			// If weight is negative, this means we have an empty history.
 			// If weight is less than -1, it represents more than one empty history.
 			// Then instead of reading another particle, just increment the weight to account for having already
@@ -464,17 +738,24 @@ void TsSourcePhaseSpace::ReadSomeDataFromFileToBuffer(std::queue<TsPrimaryPartic
 			if (fPrimaryParticle.weight < -1.)
 				fPrimaryParticle.weight+= 1.;
 			else
-				FileIsEmpty = ReadOneParticle(particleBuffer);
+				FileIsEmpty = ReadOneParticle();
 		} else {
 			fPrimaryParticle.particleDefinition = 0;
 			fNumberOfEmptyHistoriesAppended++;
 		}
 
         // If we're read the last particle in the file, close out last history
-		if ((fDataFile.tellg() == -1) || FileIsEmpty || ((fDataFile.tellg() > (fFileSize-fRecordLength)) && (fNumberOfEmptyHistoriesAppended == fNumberOfEmptyHistoriesToAppend))) {
-            if (particleBuffer && (fIncludeEmptyHistories || fPrimaryParticle.particleDefinition != 0))
+		if ((fDataStream->tellg() == -1) || FileIsEmpty || ((fDataStream->tellg() > fLastRecordStart) && (fNumberOfEmptyHistoriesAppended == fNumberOfEmptyHistoriesToAppend))) {
+            if (fIncludeEmptyHistories || fPrimaryParticle.particleDefinition != 0)
                 particleBuffer->push(fPrimaryParticle);
             nHistoriesRead++;
+
+			// A last record that stands for several empty histories supplies each of them in turn
+			while (fIncludeEmptyHistories && fPrimaryParticle.weight < -1.) {
+				fPrimaryParticle.weight+= 1.;
+				particleBuffer->push(fPrimaryParticle);
+				nHistoriesRead++;
+			}
         } else {
             if (fPrimaryParticle.isNewHistory && (fIncludeEmptyHistories || fPrimaryParticle.particleDefinition != 0))
                 nHistoriesRead++;
@@ -482,130 +763,63 @@ void TsSourcePhaseSpace::ReadSomeDataFromFileToBuffer(std::queue<TsPrimaryPartic
     }
 
     // Store file position to use at next read
-	if ((fDataFile.tellg() == -1) || ((fDataFile.tellg() > (fFileSize-fRecordLength)) && (fNumberOfEmptyHistoriesAppended == fNumberOfEmptyHistoriesToAppend))) {
-        fFilePosition = 0;
+	if ((fDataStream->tellg() == -1) || ((fDataStream->tellg() > fLastRecordStart) && (fNumberOfEmptyHistoriesAppended == fNumberOfEmptyHistoriesToAppend))) {
+        fFilePosition = fDataStartPosition;
 		fNumberOfEmptyHistoriesAppended = 0;
 	} else
-        fFilePosition = fDataFile.tellg();
+        fFilePosition = fDataStream->tellg();
+
+	if (fPrefetchBuffer)
+		fPrefetchWaitTime += fPrefetchBuffer->GetAndResetWaitTime();
+	else
+		fDataFile.close();
 
-    fDataFile.close();
+	stallTimer.Stop();
+	fStallTime += stallTimer.GetRealElapsed();
+	fNumberOfRefills++;
 }
 
 
-G4bool TsSourcePhaseSpace::ReadOneParticle(std::queue<TsPrimaryParticle>* particleBuffer)
+G4bool TsSourcePhaseSpace::ReadOneParticle()
 {
-    G4int particleCode;
-    G4bool cosZIsNegative;
-
-    if (fIsLimited) {
-        // Reading limited data
-        char conflatedParticleCodeChar;
-        fDataFile.read(reinterpret_cast<char*>(&conflatedParticleCodeChar), 1);
-        G4int conflatedParticleCode = G4int(conflatedParticleCodeChar);
-        cosZIsNegative = (conflatedParticleCode < 0);
-        particleCode = abs(conflatedParticleCode);
-
-        G4float conflatedEnergy;
-        fDataFile.read(reinterpret_cast<char*>(&conflatedEnergy), sizeof conflatedEnergy);
-        fPrimaryParticle.isNewHistory = (conflatedEnergy < 0.);
-
-        if (fLimitedAssumeEveryParticleIsNewHistory ||
-			(fLimitedAssumePhotonIsNewHistory && particleCode == 1))
-            fPrimaryParticle.isNewHistory = true;
-
-		fPrimaryParticle.kEnergy = fabs(conflatedEnergy);
-
-		fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.posX),    sizeof fPrimaryParticle.posX);
-		fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.posY),    sizeof fPrimaryParticle.posY);
-
-		if (fLimitedHasZ)
-			fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.posZ),    sizeof fPrimaryParticle.posZ);
-		else
-			fPrimaryParticle.posZ = 0.;
-
-		fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.dCos1), sizeof fPrimaryParticle.dCos1);
-		fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.dCos2), sizeof fPrimaryParticle.dCos2);
+	TsPhaseSpaceRecord record;
 
-		if (fLimitedHasWeight)
-			fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.weight),    sizeof fPrimaryParticle.weight);
-		else
-			fPrimaryParticle.weight = 1.;
+	G4long recordPosition = 0;
+	if (fRangeEndKeep > 0)
+		recordPosition = fDecoder.IsFixedLength() ? G4long(fFilePosition) : G4long(fDataStream->tellg());
 
-        // Ignore any additional parts of record
-        // Advance to next particle record in file
-        fFilePosition+=fRecordLength;
-        fDataFile.seekg(fFilePosition);
-    } else if (fIsBinary) {
-        // Reading binary data
-        fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.posX),         sizeof fPrimaryParticle.posX);
-        fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.posY),         sizeof fPrimaryParticle.posY);
-        fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.posZ),         sizeof fPrimaryParticle.posZ);
-        fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.dCos1),        sizeof fPrimaryParticle.dCos1);
-        fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.dCos2),        sizeof fPrimaryParticle.dCos2);
-        fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.kEnergy),      sizeof fPrimaryParticle.kEnergy);
-        fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.weight),       sizeof fPrimaryParticle.weight);
-        fDataFile.read(reinterpret_cast<char*>(&particleCode),                  sizeof particleCode);
-        fDataFile.read(reinterpret_cast<char*>(&cosZIsNegative),                sizeof cosZIsNegative);
-        fDataFile.read(reinterpret_cast<char*>(&fPrimaryParticle.isNewHistory), sizeof fPrimaryParticle.isNewHistory);
-
-        // Ignore any additional parts of record
-        // Advance to next particle record in file
+    if (fDecoder.IsFixedLength()) {
+        // Reading Binary or Limited data.
+        // Any additional parts of record are ignored.
+        fDataStream->read(fRecordBuffer.data(), fRecordLength);
+        fDecoder.DecodeRecord(fRecordBuffer.data(), record);
         fFilePosition+=fRecordLength;
-        fDataFile.seekg(fFilePosition);
     } else {
         // Reading ASCII data
-        getline(fDataFile,fAsciiLine);
-        if (!fDataFile.good()) return true;
-        std::istringstream input(fAsciiLine);
-        input >> fPrimaryParticle.posX >> fPrimaryParticle.posY >> fPrimaryParticle.posZ >> fPrimaryParticle.dCos1 >> fPrimaryParticle.dCos2
-        >> fPrimaryParticle.kEnergy >> fPrimaryParticle.weight >> particleCode >> cosZIsNegative >> fPrimaryParticle.isNewHistory;
-    }
-
-    // Lack of particle buffer means we are doing PreCheck
-    if (!particleBuffer) {
-		if (fPrimaryParticle.weight >= 0.) {
-            fPreCheckNumberOfParticles++;
-			if (fPreCheckShowParticleCountAtInterval!=0 && std::fmod(fPreCheckNumberOfParticles, fPreCheckShowParticleCountAtInterval)==0)
-				G4cout << "PreCheck processing particle: " << fPreCheckNumberOfParticles << G4endl;
-		}
-
-        if (fPrimaryParticle.isNewHistory) {
-            if (fPrimaryParticle.weight < 0.) {
-                fPreviousHistoryWasEmpty = true;
-                fPreCheckNumberOfHistories += std::lround(-fPrimaryParticle.weight);
-			} else {
-				fPreCheckNumberOfHistories++;
-                fPreCheckNumberOfNonEmptyHistories++;
-                fPreviousHistoryWasEmpty = false;
-			}
-        } else {
-            if (fPrimaryParticle.weight < 0.) {
-                G4cerr << "Error reading phase space file." << G4endl;
-                G4cerr << "A particle has been read with a negative weight but no IsNewHistory flag." << G4endl;
-				G4cerr << "Negative weight is used to represent one or more empty histories," << G4endl;
-				G4cerr << "so must always have the IsNewHistory flag." << G4endl;
-                fPm->AbortSession(1);
-            }
-            if (fPreviousHistoryWasEmpty) {
-                G4cerr << "Error reading phase space file." << G4endl;
-                G4cerr << "Read a particle that does not have the IsNewHistory flag" << G4endl;
-                G4cerr << "right after reading an empty history. This does not make sense." << G4endl;
-                fPm->AbortSession(1);
-            }
+        getline(*fDataStream,fAsciiLine);
+        if (!fDataStream->good()) return true;
+        if (!fDecoder.DecodeLine(fAsciiLine.data(), fAsciiLine.data() + fAsciiLine.size(), record)) {
+            G4cerr << "Error reading phase space file." << G4endl;
+            G4cerr << "A line does not hold the ten columns expected in TOPAS ASCII format:" << G4endl;
+            G4cerr << fAsciiLine << G4endl;
+            fPm->AbortSession(1);
         }
+    }
 
-		if (particleCode > 999999999 && (particleCode % 10) != 0 && !fPm->GetBooleanParameter("Ts/TreatExcitedIonsAsGroundState"))
-		{
-			G4cerr << "A phase space input file or filter parameter is using a PDG" << G4endl;
-			G4cerr << "particle code that corresponds to an ion in an excited state." << G4endl;
-			G4cerr << "This is any ten digit PDG code that does not end in a zero." << G4endl;
-			G4cerr << "The PDG code seen here was: " << particleCode << G4endl;
-			G4cerr << "TOPAS can only handle such ions by treating them as ground state." << G4endl;
-			G4cerr << "To accept this compromise, set" << G4endl;
-			G4cerr << "Ts/TreatExcitedIonsAsGroundState to True." << G4endl;
-			fPm->AbortSession(1);
-		}
-	}
+	// Last record of a history range keeps only the empty histories that fall within the range
+	if (fRangeEndKeep > 0 && recordPosition == fRangeEndRecordPosition && record.weight < 0.)
+		record.weight = -fRangeEndKeep;
+
+	fPrimaryParticle.posX = record.posX;
+	fPrimaryParticle.posY = record.posY;
+	fPrimaryParticle.posZ = record.posZ;
+	fPrimaryParticle.dCos1 = record.dCos1;
+	fPrimaryParticle.dCos2 = record.dCos2;
+	fPrimaryParticle.kEnergy = record.kEnergy;
+	fPrimaryParticle.weight = record.weight;
+	fPrimaryParticle.isNewHistory = record.isNewHistory;
+	G4int particleCode = record.particleCode;
+	G4bool cosZIsNegative = record.cosZIsNegative;
 
 	if (fPrimaryParticle.weight < 0.) {
 		fPrimaryParticle.particleDefinition = 0;
@@ -643,31 +857,16 @@ G4bool TsSourcePhaseSpace::ReadOneParticle(std::queue<TsPrimaryParticle>* partic
 
 		// Particle definition
 		if (fIsLimited) {
-			switch(particleCode)
-			{
-				case 1:
-					particleCode = 22;  // gamma
-					break;
-				case 2:
-					particleCode = 11;  // electron
-					break;
-				case 3:
-					particleCode = -11;  // positron
-					break;
-				case 4:
-					particleCode = 2112;  // neutron
-					break;
-				case 5:
-					particleCode = 2212;  // proton
-					break;
-				default:
-					if (fIgnoreUnsupportedParticles) {
-						return false;
-					} else {
-						G4cerr << "TOPAS is quitting due to a serious error in specification of particle source: " << GetName() << G4endl;
-						G4cerr << "\"limited\" format phase space does not support particle ID: " << particleCode << G4endl;
-						fPm->AbortSession(1);
-					}
+			G4int limitedCode = particleCode;
+			particleCode = TsPhaseSpaceDecoder::LimitedCodeToPDG(limitedCode);
+			if (particleCode == 0) {
+				if (fIgnoreUnsupportedParticles) {
+					return false;
+				} else {
+					G4cerr << "TOPAS is quitting due to a serious error in specification of particle source: " << GetName() << G4endl;
+					G4cerr << "\"limited\" format phase space does not support particle ID: " << limitedCode << G4endl;
+					fPm->AbortSession(1);
+				}
 			}
 		}
 
@@ -34,9 +34,14 @@
 #include "TsSource.hh"
 
 #include "TsPrimaryParticle.hh"
+#include "TsPhaseSpaceDecoder.hh"
 
 #include <queue>
 #include <fstream>
+#include <vector>
+
+class TsPhaseSpaceIndex;
+class TsPhaseSpacePrefetchBuffer;
 
 class TsSourcePhaseSpace : public TsSource
 {
@@ -46,24 +51,48 @@ public:
 
 	void ResolveParameters();
 
+	void UpdateForEndOfRun();
+
 	void ReadSomeDataFromFileToBuffer(std::queue<TsPrimaryParticle>* particleBuffer);
 
-    G4bool ReadOneParticle(std::queue<TsPrimaryParticle>* particleBuffer);
+    G4bool ReadOneParticle();
 
     G4long GetFileSize(std::string filename);
 
 private:
+	void PreCheck();
+	void SetUpHistoryRange();
+	void ReportPreCheckProblem();
+	void ReportFirstParticleNotNewHistory(const G4String& dataFileSpec);
+
 	G4String fFileName;
     G4int fRecordLength;
     G4long fFileSize;
     std::ifstream fDataFile;
+	std::istream* fDataStream;
+	TsPhaseSpacePrefetchBuffer* fPrefetchBuffer;
+	std::istream* fPrefetchStream;
+	G4int fPrefetchDepth;
+	G4long fPrefetchBlockSize;
+	G4double fStallTime;
+	G4double fPrefetchWaitTime;
+	G4long fNumberOfRefills;
     std::streampos fFilePosition;
+	G4long fDataStartPosition;
+	G4long fDataEndPosition;
+	G4long fLastRecordStart;
+	G4long fRangeStartSkip;
+	G4long fRangeEndRecordPosition;
+	G4long fRangeEndKeep;
+	G4long fRangeNumberOfHistories;
     G4String fAsciiLine;
+	std::vector<char> fRecordBuffer;
+	TsPhaseSpaceDecoder fDecoder;
+	TsPhaseSpaceIndex* fIndex;
     G4bool fIgnoreUnsupportedParticles;
     G4bool fIncludeEmptyHistories;
 	G4long fNumberOfEmptyHistoriesToAppend;
 	G4long fNumberOfEmptyHistoriesAppended;
-    G4bool fPreviousHistoryWasEmpty;
 	G4int fMultipleUse;
 	G4bool fIsBinary;
 	G4bool fIsLimited;
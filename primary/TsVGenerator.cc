@@ -135,6 +135,17 @@ void TsVGenerator::UpdateForNewRun(G4bool rebuiltSomeComponents) {
 }
 
 
+// Time changed between events of one run, so only pick up parameter changes, leaving the run counters alone
+void TsVGenerator::UpdateForNewTime() {
+	fProbabilityOfUsingAGivenRandomTime = fPs->GetProbabilityOfUsingAGivenRandomTime();
+
+	if (fHadParameterChangeSinceLastRun) {
+		ResolveParameters();
+		fHadParameterChangeSinceLastRun = false;
+	}
+}
+
+
 void TsVGenerator::ClearGenerator() {
 }
 
@@ -128,6 +128,7 @@ protected:
 
 public:
 	virtual void UpdateForNewRun(G4bool rebuiltSomeComponents);
+	void UpdateForNewTime();
 	virtual void ClearGenerator();
 
 	void SetFilter(TsVFilter* filter);
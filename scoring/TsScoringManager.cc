@@ -50,7 +50,7 @@
 
 TsScoringManager::TsScoringManager(TsParameterManager* pM, TsExtensionManager* eM, TsMaterialManager* mM, TsGeometryManager* gM, TsFilterManager* fM)
 :fPm(pM), fEm(eM), fMm(mM), fGm(gM), fFm(fM),
-fAddUnitEvenIfItIsOne(false), fRootAnalysisManager(0), fXmlAnalysisManager(0), fUID(0)
+fAddUnitEvenIfItIsOne(false), fRootAnalysisManager(0), fXmlAnalysisManager(0), fOutputPrefix(""), fUID(0)
 {
 #ifdef TOPAS_MT
 	fCurrentScorerName.Put("");
@@ -469,7 +469,8 @@ void TsScoringManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 		G4String nameToLower = name;
 		G4StrUtil::to_lower(nameToLower);
 		std::multimap< G4String, std::pair< TsVScorer*,G4String> >::const_iterator iter;
-		for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end() && !matched; iter++) {
+		std::multimap< G4String, std::pair< TsVScorer*,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(nameToLower);
+		for (iter = fChangeableParameterMap.lower_bound(nameToLower); iter != last && !matched; iter++) {
 			G4String gotParm = iter->first;
 			TsVScorer* gotScorer = iter->second.first;
 			G4String gotDirectParm = iter->second.second;
@@ -484,6 +485,7 @@ void TsScoringManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 #ifdef TOPAS_MT
 		if (!matched) {
 			fChangeableParameterMap.insert(std::make_pair(nameToLower, std::make_pair(fCurrentScorer.Get(), directParm)));
+			fPm->RegisterParameterConsumer(name, "scorer", fCurrentScorer.Get()->GetNameWithSplitId(), directParm);
 			if (fTfVerbosity > 0)
 				G4cout << "Registered use of changeable parameter: " << name << "  by scorer: " << fCurrentScorer.Get()->GetNameWithSplitId() << G4endl;
 		}
@@ -497,6 +499,7 @@ void TsScoringManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 #else
 		if (!matched) {
 			fChangeableParameterMap.insert(std::make_pair(nameToLower, std::make_pair(fCurrentScorer, directParm)));
+			fPm->RegisterParameterConsumer(name, "scorer", fCurrentScorer->GetNameWithSplitId(), directParm);
 			if (fTfVerbosity > 0)
 				G4cout << "Registered use of changeable parameter: " << name << "  by scorer: " << fCurrentScorer->GetNameWithSplitId() << G4endl;
 		}
@@ -514,7 +517,8 @@ void TsScoringManager::NoteAnyUseOfChangeableParameters(const G4String& name)
 
 void TsScoringManager::UpdateForSpecificParameterChange(G4String parameter) {
 	std::multimap< G4String, std::pair<TsVScorer*,G4String> >::const_iterator iter;
-	for (iter = fChangeableParameterMap.begin(); iter != fChangeableParameterMap.end(); iter++) {
+	std::multimap< G4String, std::pair<TsVScorer*,G4String> >::const_iterator last = fChangeableParameterMap.upper_bound(parameter);
+	for (iter = fChangeableParameterMap.lower_bound(parameter); iter != last; iter++) {
 		if (iter->first==parameter) {
 			G4String directParameterName = iter->second.second;
 			if (fTfVerbosity > 0)
@@ -539,6 +543,16 @@ void TsScoringManager::UpdateForNewRun(G4bool rebuiltSomeComponents) {
 }
 
 
+G4bool TsScoringManager::AnyScorerOutputsAfterEachRun() {
+	std::vector<TsVScorer*>::iterator mIter;
+	for (mIter=fMasterScorers.begin(); mIter!=fMasterScorers.end(); mIter++)
+		if ((*mIter)->OutputsAfterEachRun())
+			return true;
+
+	return false;
+}
+
+
 G4bool TsScoringManager::HasUnsatisfiedLimits() {
 	std::vector<TsVScorer*>::iterator mIter;
 	for (mIter=fMasterScorers.begin(); mIter!=fMasterScorers.end(); mIter++)
@@ -627,7 +641,7 @@ G4RootAnalysisManager* TsScoringManager::GetRootAnalysisManager() {
 	// Otherwise, instantiate it and open the output file.
 	if (!fRootAnalysisManager) {
 		fRootAnalysisManager = G4RootAnalysisManager::Instance();
-		fRootAnalysisManager->OpenFile(fPm->GetStringParameter("Sc/RootFileName"));
+		fRootAnalysisManager->OpenFile(PrefixOutputFileName(fPm->GetStringParameter("Sc/RootFileName")));
 	}
 
 	return fRootAnalysisManager;
@@ -639,13 +653,39 @@ G4XmlAnalysisManager* TsScoringManager::GetXmlAnalysisManager() {
 	// Otherwise, instantiate it and open the output file.
 	if (!fXmlAnalysisManager) {
 		fXmlAnalysisManager = G4XmlAnalysisManager::Instance();
-		fXmlAnalysisManager->OpenFile(fPm->GetStringParameter("Sc/XmlFileName"));
+		fXmlAnalysisManager->OpenFile(PrefixOutputFileName(fPm->GetStringParameter("Sc/XmlFileName")));
 	}
 
 	return fXmlAnalysisManager;
 }
 
 
+void TsScoringManager::SetOutputPrefix(const G4String& prefix) {
+	fOutputPrefix = prefix;
+
+	std::vector<TsVScorer*>::iterator iter;
+	for (iter=fMasterScorers.begin(); iter!=fMasterScorers.end(); iter++)
+		(*iter)->UpdateOutputFileName();
+
+	// Finalize closed these files at the end of the previous sequence
+	if (fRootAnalysisManager)
+		fRootAnalysisManager->OpenFile(PrefixOutputFileName(fPm->GetStringParameter("Sc/RootFileName")));
+
+	if (fXmlAnalysisManager)
+		fXmlAnalysisManager->OpenFile(PrefixOutputFileName(fPm->GetStringParameter("Sc/XmlFileName")));
+}
+
+
+// The prefix goes on the file name itself, not on any directory part
+G4String TsScoringManager::PrefixOutputFileName(const G4String& fileName) {
+	size_t lastSlashPos = fileName.find_last_of("/");
+	if (lastSlashPos == G4String::npos)
+		return fOutputPrefix + fileName;
+
+	return fileName.substr(0, lastSlashPos + 1) + fOutputPrefix + fileName.substr(lastSlashPos + 1);
+}
+
+
 G4String TsScoringManager::GetFullParmName(const char* parmName) {
 #ifdef TOPAS_MT
 	G4String fullName = "Sc/"+fCurrentScorerName.Get()+"/"+parmName;
@@ -70,6 +70,7 @@ public:
 	void NoteAnyUseOfChangeableParameters(const G4String& name);
 	void UpdateForSpecificParameterChange(G4String parameter);
 	void UpdateForNewRun(G4bool rebuiltSomeComponents);
+	G4bool AnyScorerOutputsAfterEachRun();
 
 	G4bool HasUnsatisfiedLimits();
 
@@ -83,6 +84,10 @@ public:
 	G4RootAnalysisManager* GetRootAnalysisManager();
 	G4XmlAnalysisManager* GetXmlAnalysisManager();
 
+	// Each variant of a parameter sweep writes its results under its own prefix
+	void SetOutputPrefix(const G4String& prefix);
+	G4String PrefixOutputFileName(const G4String& fileName);
+
 	G4MultiFunctionalDetector* GetDetector(G4String componentName, TsVScorer* scorer);
 
 	TsExtensionManager* GetExtensionManager();
@@ -107,6 +112,7 @@ private:
 	TsScoringHub* fScoringHub;
 
 	G4String fQuantityParmName;
+	G4String fOutputPrefix;
 
 	std::map<G4String,G4MultiFunctionalDetector*>* fDetectors;
 
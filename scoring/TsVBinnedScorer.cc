@@ -744,29 +744,7 @@ void TsVBinnedScorer::PostConstructor()
         if (!G4Threading::IsWorkerThread()) {
 #endif
             if ((!fOutputAfterRun || fPm->IsRandomMode()) && !fIsSubScorer) {
-                G4int increment = 0;
-                if (fOutputToBinary) {
-                    G4String outFileExt1 = ".binheader";
-                    G4String outFileExt2 = ".bin";
-                    if (fNumberOfOutputColumns > 0) {
-                        fOutFileSpec1 = ConfirmCanOpen(fOutFileName, outFileExt1, increment);
-                        fOutFileSpec2 = ConfirmCanOpen(fOutFileName, outFileExt2, increment);
-                    }
-                    if (fReportCVolHist || fReportDVolHist) {
-                        fVHOutFileSpec1 = ConfirmCanOpen(fOutFileName+"_VolHist", outFileExt1, increment);
-                        fVHOutFileSpec2 = ConfirmCanOpen(fOutFileName+"_VolHist", outFileExt2, increment);
-                    }
-                } else if (fOutputToCsv) {
-                    G4String outFileExt1 = ".csv";
-                    if (fNumberOfOutputColumns > 0)
-                        fOutFileSpec1 = ConfirmCanOpen(fOutFileName, outFileExt1, increment);
-                    if (fReportCVolHist || fReportDVolHist)
-                        fVHOutFileSpec1 = ConfirmCanOpen(fOutFileName+"_VolHist", outFileExt1, increment);
-                } else if (fOutputToDicom) {
-                    G4String outFileExt1 = ".dcm";
-                    fOutFileSpec1 = ConfirmCanOpen(fOutFileName, outFileExt1, increment);
-                }
-                
+                UpdateFileSpecs(fOutFileName);
                 fNeedToUpdateFileSpecs = false;
             }
 #ifdef TOPAS_MT
@@ -1857,6 +1835,43 @@ G4String TsVBinnedScorer::GetOneTokenFromReadLine() {
 }
 
 
+void TsVBinnedScorer::UpdateFileSpecs(const G4String& outFileName)
+{
+    G4int increment = 0;
+    if (fOutputToBinary) {
+        G4String outFileExt1 = ".binheader";
+        G4String outFileExt2 = ".bin";
+        if (fNumberOfOutputColumns > 0) {
+            fOutFileSpec1 = ConfirmCanOpen(outFileName, outFileExt1, increment);
+            fOutFileSpec2 = ConfirmCanOpen(outFileName, outFileExt2, increment);
+        }
+        if (fReportCVolHist || fReportDVolHist) {
+            fVHOutFileSpec1 = ConfirmCanOpen(outFileName+"_VolHist", outFileExt1, increment);
+            fVHOutFileSpec2 = ConfirmCanOpen(outFileName+"_VolHist", outFileExt2, increment);
+        }
+    } else if (fOutputToCsv) {
+        G4String outFileExt1 = ".csv";
+        if (fNumberOfOutputColumns > 0)
+            fOutFileSpec1 = ConfirmCanOpen(outFileName, outFileExt1, increment);
+        if (fReportCVolHist || fReportDVolHist)
+            fVHOutFileSpec1 = ConfirmCanOpen(outFileName+"_VolHist", outFileExt1, increment);
+    } else if (fOutputToDicom) {
+        G4String outFileExt1 = ".dcm";
+        fOutFileSpec1 = ConfirmCanOpen(outFileName, outFileExt1, increment);
+    }
+}
+
+
+// File specs that were fixed in the constructor must be worked out again for the new name
+void TsVBinnedScorer::UpdateOutputFileName()
+{
+    TsVScorer::UpdateOutputFileName();
+
+    if (!fNeedToUpdateFileSpecs && !fSuppressStandardOutputHandling && !fIsSubScorer)
+        UpdateFileSpecs(fOutFileName);
+}
+
+
 void TsVBinnedScorer::Output()
 {
 #ifdef TOPAS_MT
@@ -1883,29 +1898,7 @@ void TsVBinnedScorer::Output()
             runString = ss.str();
         }
         
-        G4int increment = 0;
-        G4String outFileNameWithRun = fOutFileName + runString;
-        if (fOutputToBinary) {
-            G4String outFileExt1 = ".binheader";
-            G4String outFileExt2 = ".bin";
-            if (fNumberOfOutputColumns > 0) {
-                fOutFileSpec1 = ConfirmCanOpen(outFileNameWithRun, outFileExt1, increment);
-                fOutFileSpec2 = ConfirmCanOpen(outFileNameWithRun, outFileExt2, increment);
-            }
-            if (fReportCVolHist || fReportDVolHist) {
-                fVHOutFileSpec1 = ConfirmCanOpen(outFileNameWithRun+"_VolHist", outFileExt1, increment);
-                fVHOutFileSpec2 = ConfirmCanOpen(outFileNameWithRun+"_VolHist", outFileExt2, increment);
-            }
-        } else if (fOutputToCsv) {
-            G4String outFileExt1 = ".csv";
-            if (fNumberOfOutputColumns > 0)
-                fOutFileSpec1 = ConfirmCanOpen(outFileNameWithRun, outFileExt1, increment);
-            if (fReportCVolHist || fReportDVolHist)
-                fVHOutFileSpec1 = ConfirmCanOpen(outFileNameWithRun+"_VolHist", outFileExt1, increment);
-        } else if (fOutputToDicom) {
-            G4String outFileExt1 = ".dcm";
-            fOutFileSpec1 = ConfirmCanOpen(outFileNameWithRun, outFileExt1, increment);
-        }
+        UpdateFileSpecs(fOutFileName + runString);
     }
     
     
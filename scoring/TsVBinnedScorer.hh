@@ -64,6 +64,7 @@ protected:
 // User classes should not access any methods or data beyond this point
 public:
 	void UpdateForNewRun(G4bool rebuiltSomeComponents);
+	void UpdateOutputFileName();
 	G4bool HasUnsatisfiedLimits();
 
 	void PostConstructor();
@@ -80,6 +81,7 @@ protected:
 	void GetAppropriatelyBinnedCopyOfComponent(G4String componentName);
 
 	G4String ConfirmCanOpen(G4String fileName, G4String fileExt, G4int& increment);
+	void UpdateFileSpecs(const G4String& outFileName);
 	virtual void Output();
 	virtual void Clear();
 
@@ -69,7 +69,7 @@ fSolid(NULL), fPm(pM), fOutFile(NULL),
 fIsActive(true), fSkippedWhileInactive(0),
 fUID(0), fScm(scM), fGm(gM), fEm(eM),
 fScoredHistories(0), fHitsWithNoIncidentParticle(0), fUnscoredSteps(0), fUnscoredEnergy(0.), fMissedSubScorerVoxels(0),
-fOutFileName(outFileName), fOutputAfterRun(false), fOutputAfterRunShouldAccumulate(false), fQuantity(quantity),
+fOutFileName(scM->PrefixOutputFileName(outFileName)), fUnprefixedOutFileName(outFileName), fOutputAfterRun(false), fOutputAfterRunShouldAccumulate(false), fQuantity(quantity),
 fComponent(NULL), fDetector(NULL), fComponentName(""),
 fNDivisions(1), fSuppressStandardOutputHandling(false),
 fIsSubScorer(isSubScorer), fHasCombinedSubScorers(false),
@@ -433,6 +433,13 @@ void TsVScorer::PostFinalize()
 }
 
 
+void TsVScorer::UpdateOutputFileName()
+{
+	fOutFileName = fScm->PrefixOutputFileName(fUnprefixedOutFileName);
+	UpdateFileNameForUpcomingRun();
+}
+
+
 void TsVScorer::UpdateForNewRun(G4bool rebuiltSomeComponents)
 {
 	if (fVerbosity>0) {
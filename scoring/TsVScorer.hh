@@ -180,6 +180,8 @@ public:
 	virtual G4bool HasUnsatisfiedLimits() { return false; }
 	void Finalize();
 	void PostFinalize();
+	virtual void UpdateOutputFileName();
+	G4bool OutputsAfterEachRun() { return fOutputAfterRun; }
 
 	void ClearIncidentParticleInfo();
 	void NoteIncidentParticleInfo(const G4Step* aStep);
@@ -224,6 +226,7 @@ protected:
 	G4String fOutFileType;
 	G4String fOutFileMode;
 	G4String fOutFileName;
+	G4String fUnprefixedOutFileName;
 	G4bool fOutputAfterRun;
 	G4bool fOutputAfterRunShouldAccumulate;
 
@@ -42,7 +42,13 @@
 #include "G4Event.hh"
 
 TsEventAction::TsEventAction(TsParameterManager* pM, TsExtensionManager* eM, TsSequenceManager* sqM)
-: fPm(pM), fEm(eM), fSqm(sqM), fIsFirstEventInThisThread(true), fNumberOfAnomalousHistoriesInARow(0)
+: fPm(pM), fEm(eM), fSqm(sqM), fIsFirstEventInThisThread(true), fNumberOfAnomalousHistoriesInARow(0),
+fIncludeTimeInHistoryCount(pM, "Ts/IncludeTimeInHistoryCount"),
+fShowHistoryCountOnSingleLine(pM, "Ts/ShowHistoryCountOnSingleLine"),
+fShowHistoryCountLessFrequently(pM, "Ts/ShowHistoryCountLessFrequentlyAsSimulationProgresses"),
+fMaxShowHistoryCountInterval(pM, "Ts/MaxShowHistoryCountInterval"),
+fQuitIfManyHistoriesSeemAnomalous(pM, "Ts/QuitIfManyHistoriesSeemAnomalous"),
+fNumberOfAnomalousHistoriesToAllowInARow(pM, "Ts/NumberOfAnomalousHistoriesToAllowInARow")
 {
 	fInterval = fPm->GetIntegerParameter("Ts/ShowHistoryCountAtInterval");
 }
@@ -53,14 +59,15 @@ TsEventAction::~TsEventAction()
 
 
 void TsEventAction::BeginOfEventAction(const G4Event* event) {
+	// Random time mode has one history per run, unless time is being sampled per event
 	G4int counter;
 	if (fPm->IsRandomMode())
-		counter = fPm->GetRunID();
+		counter = fPm->GetRunID() + event->GetEventID();
 	else
 		counter = event->GetEventID();
 
 	if (fInterval!=0 && std::fmod(counter, fInterval)==0) {
-		if (fPm->GetBooleanParameter("Ts/IncludeTimeInHistoryCount")) {
+		if (fIncludeTimeInHistoryCount.Get()) {
 			char       buf[80];
 			time_t     now = time(0);
 			struct tm  tstruct = *localtime(&now);
@@ -68,16 +75,16 @@ void TsEventAction::BeginOfEventAction(const G4Event* event) {
 			G4cout << buf << "  ";
 		}
 
-		if (fPm->GetBooleanParameter("Ts/ShowHistoryCountOnSingleLine"))
+		if (fShowHistoryCountOnSingleLine.Get())
 			G4cout << "Begin processing for Run: " << fPm->GetRunID() << ", History: " <<  event->GetEventID() << '\r';
 		else
 			G4cout << "Begin processing for Run: " << fPm->GetRunID() << ", History: " <<  event->GetEventID() << G4endl;
 	}
 
-	if (fPm->GetBooleanParameter("Ts/ShowHistoryCountLessFrequentlyAsSimulationProgresses") && counter == fInterval*10) {
+	if (fShowHistoryCountLessFrequently.Get() && counter == fInterval*10) {
 		G4int intervalWas = fInterval;
 		fInterval *= 10;
-		fInterval = fmin(fPm->GetIntegerParameter("Ts/MaxShowHistoryCountInterval"), fInterval);
+		fInterval = fmin(fMaxShowHistoryCountInterval.Get(), fInterval);
 		if (fInterval != intervalWas)
 			G4cout << "Resetting history count interval to: " << fInterval << G4endl;
 	}
@@ -105,8 +112,8 @@ void TsEventAction::EndOfEventAction(const G4Event* event) {
 	if ((((TsSteppingAction*)G4RunManager::GetRunManager()->GetUserSteppingAction())->GetStepCount() == 1) &&
 		(((TsSteppingAction*)G4RunManager::GetRunManager()->GetUserSteppingAction())->GetMostRecentStep()->GetPostStepPoint()->GetTouchable()->GetVolume())) {
 		fNumberOfAnomalousHistoriesInARow++;
-		if (fPm->GetBooleanParameter("Ts/QuitIfManyHistoriesSeemAnomalous") &&
-			(fNumberOfAnomalousHistoriesInARow >= fPm->GetIntegerParameter("Ts/NumberOfAnomalousHistoriesToAllowInARow"))) {
+		if (fQuitIfManyHistoriesSeemAnomalous.Get() &&
+			(fNumberOfAnomalousHistoriesInARow >= fNumberOfAnomalousHistoriesToAllowInARow.Get())) {
 			G4cerr << "" << G4endl;
 			G4cerr << "TOPAS has detected a condition that may mean Geant4 is no longer correctly transporting particles." << G4endl;
 			G4cerr << "There have been " << fNumberOfAnomalousHistoriesInARow << " histories in a row that each had only a single track," << G4endl;
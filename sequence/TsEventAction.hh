@@ -33,6 +33,8 @@
 
 #include "G4UserEventAction.hh"
 
+#include "TsParameterHandle.hh"
+
 #include "globals.hh"
 
 #include <vector>
@@ -64,6 +66,13 @@ private:
 	
 	G4int fInterval;
 	G4int fNumberOfAnomalousHistoriesInARow;
+
+	TsBooleanParameterHandle fIncludeTimeInHistoryCount;
+	TsBooleanParameterHandle fShowHistoryCountOnSingleLine;
+	TsBooleanParameterHandle fShowHistoryCountLessFrequently;
+	TsIntegerParameterHandle fMaxShowHistoryCountInterval;
+	TsBooleanParameterHandle fQuitIfManyHistoriesSeemAnomalous;
+	TsIntegerParameterHandle fNumberOfAnomalousHistoriesToAllowInARow;
 };
 
 #endif
@@ -68,6 +68,8 @@
 #include "G4SystemOfUnits.hh"
 #include "G4StateManager.hh"
 
+#include <algorithm>
+
 
 #ifdef TOPAS_MT
 namespace {
@@ -87,7 +89,7 @@ TsSequenceManager::TsSequenceManager(TsParameterManager* pM, TsExtensionManager*
 : fPm(pM), fEm(eM), fMm(mM), fGm(gM), fPhm(phM), fVm(vM), fFm(fM), fScm(scM), fGrm(grM), fSom(soM), fChm(chM), fUseQt(false), fTsQt(0), fRunID(-1),
 fKilledTrackEnergy(0.), fKilledTrackCount(0), fUnscoredHitEnergy(0.), fUnscoredHitCount(0),
 fParameterizationErrorEnergy(0.), fParameterizationErrorCount(0), fIndexErrorEnergy(0.), fIndexErrorCount(0), fInterruptedHistoryCount(0),
-fIsExecutingSequence(false)
+fIsExecutingSequence(false), fIsSweeping(false), fSampleTimePerEvent(false), fRandomTimeStart(0.), fRandomTimeInterval(0.), fMergingTimes(false)
 {
 	// Instantiate G4UIExecutive at start if a session is going to be needed so that G4cout, etc., can be captured.
 	G4UIExecutive* ui = 0;
@@ -261,7 +263,10 @@ fIsExecutingSequence(false)
 
 	// Qt users trigger the Sequence by hitting the appropriate widget in the Qt GUI
 	if (!fUseQt) {
-		Sequence();
+		if (fPm->ParameterExists("Ts/SweepFiles"))
+			Sweep();
+		else
+			Sequence();
 
 		if (fPm->ParameterExists("Ts/ExtraSequenceFiles")) {
 			G4String* extraSequenceFileSpecs = fPm->GetStringVector("Ts/ExtraSequenceFiles");
@@ -290,47 +295,51 @@ TsSequenceManager::~TsSequenceManager()
 {}
 
 
-void TsSequenceManager::Sequence() {
-	// Do this part only once. The rest may happen more than once if sequence is triggered by Qt
-	if (fRunID == -1) {
-		// Initialize the particle sources.
-		fSom->Initialize(this);
-
-		// Initialize the scoring.
-		// Must come after physics is initialized, since needs pointers to specific particles and processes.
-		fScm->Initialize();
-
-		// Only advance runID after scorers are initialized, so that runID of -1 indicates not yet running
-		fRunID++;
-
-		// If restoring results from file, skip all of the actual Geant4 run work. But calls instantiate 
-		// filter to allow using the mask of Dicom-RT structures 
-		if (fPm->GetBooleanParameter("Ts/RestoreResultsFromFile")) {
-			fTimer[0].Stop();
-			G4cout << "\nRestoring results from file rather than performing simulation run." << G4endl;
-			fScm->InstantiateFilters();
-			fScm->RestoreResultsFromFile();
-			BeamOn(0); // Empty run to avoid segmentation fault
-		} else {
-			// Initialize the variance reduction:
-			if (fPm->UseVarianceReduction())
-					fVm->Initialize();
-
-			// Show the list of physics processes:
-			if (fPm->ParameterExists("Ph/ListProcesses") && fPm->GetBooleanParameter("Ph/ListProcesses") ) {
-				G4cout << "\nRegistered Physics Processes:" << G4endl;
-				G4UImanager::GetUIpointer()->ApplyCommand("/process/list");
-				G4cout << "" << G4endl;
-			}
+void TsSequenceManager::InitializeSequence() {
+	// Initialize the particle sources.
+	fSom->Initialize(this);
 
-			// Set thread buffering option
-			if(fPm->GetBooleanParameter("Ts/BufferThreadOutput"))
-				G4UImanager::GetUIpointer()->ApplyCommand("/control/cout/useBuffer true");
+	// Initialize the scoring.
+	// Must come after physics is initialized, since needs pointers to specific particles and processes.
+	fScm->Initialize();
+
+	// Only advance runID after scorers are initialized, so that runID of -1 indicates not yet running
+	fRunID++;
 
-			// Finished with all initialization
-			fTimer[0].Stop();
+	// If restoring results from file, skip all of the actual Geant4 run work. But calls instantiate 
+	// filter to allow using the mask of Dicom-RT structures 
+	if (fPm->GetBooleanParameter("Ts/RestoreResultsFromFile")) {
+		fTimer[0].Stop();
+		G4cout << "\nRestoring results from file rather than performing simulation run." << G4endl;
+		fScm->InstantiateFilters();
+		fScm->RestoreResultsFromFile();
+		BeamOn(0); // Empty run to avoid segmentation fault
+	} else {
+		// Initialize the variance reduction:
+		if (fPm->UseVarianceReduction())
+				fVm->Initialize();
+
+		// Show the list of physics processes:
+		if (fPm->ParameterExists("Ph/ListProcesses") && fPm->GetBooleanParameter("Ph/ListProcesses") ) {
+			G4cout << "\nRegistered Physics Processes:" << G4endl;
+			G4UImanager::GetUIpointer()->ApplyCommand("/process/list");
+			G4cout << "" << G4endl;
 		}
+
+		// Set thread buffering option
+		if(fPm->GetBooleanParameter("Ts/BufferThreadOutput"))
+			G4UImanager::GetUIpointer()->ApplyCommand("/control/cout/useBuffer true");
+
+		// Finished with all initialization
+		fTimer[0].Stop();
 	}
+}
+
+
+void TsSequenceManager::Sequence() {
+	// Do this part only once. The rest may happen more than once if sequence is triggered by Qt
+	if (fRunID == -1)
+		InitializeSequence();
 
 	if (fGrm->UsingRayTracer()) {
 		G4cout << "At least one Graphics View has been set to type \"RayTracer\" " << G4endl;
@@ -380,8 +389,19 @@ void TsSequenceManager::Sequence() {
 					G4cerr << "Topas quitting. Total time interval has been set less than or equal to zero in Random Time Mode." << G4endl;
 					exit(1);
 				}
-				while ( fSom->RandomModeNeedsMoreRuns() )
-					Run(timelineStart + timelineTotal * G4UniformRand());
+				if (fPm->GetBooleanParameter("Tf/RandomizeTimePerEvent") && CanSampleTimePerEvent()) {
+					// Each run covers all remaining histories, with a new time sampled for every event.
+					// Further runs are only needed if sources skipped some of the sampled times.
+					fSampleTimePerEvent = true;
+					fRandomTimeStart = timelineStart;
+					fRandomTimeInterval = timelineTotal;
+					while ( fSom->RandomModeNeedsMoreRuns() )
+						Run(timelineStart + timelineTotal * G4UniformRand());
+					fSampleTimePerEvent = false;
+				} else {
+					while ( fSom->RandomModeNeedsMoreRuns() )
+						Run(timelineStart + timelineTotal * G4UniformRand());
+				}
 
 			} else {
 				// Sequential Time Mode: have one run for each sequential time.
@@ -397,8 +417,17 @@ void TsSequenceManager::Sequence() {
 						exit(1);
 					}
 					G4double timelineInterval = timelineTotal / numTimes;
-					for ( G4int steps =0; steps < numTimes; ++steps )
-						Run(timelineStart + steps*timelineInterval);
+					if (fPm->GetBooleanParameter("Tf/MergeSequentialTimes") && !fScm->AnyScorerOutputsAfterEachRun()) {
+						std::vector<G4double> times;
+						for ( G4int steps =0; steps < numTimes; ++steps )
+							times.push_back(timelineStart + steps*timelineInterval);
+						RunMergedTimes(times);
+					} else {
+						if (fPm->GetBooleanParameter("Tf/MergeSequentialTimes"))
+							G4cout << "Tf/MergeSequentialTimes is ignored since at least one scorer has OutputAfterRun set." << G4endl;
+						for ( G4int steps =0; steps < numTimes; ++steps )
+							Run(timelineStart + steps*timelineInterval);
+					}
 				}
 			}
 			hasUnsatisfiedLimits = fScm->HasUnsatisfiedLimits();
@@ -534,6 +563,16 @@ G4bool TsSequenceManager::IsExecutingSequence() {
 }
 
 
+G4bool TsSequenceManager::IsSamplingTimePerEvent() {
+	return fSampleTimePerEvent;
+}
+
+
+G4bool TsSequenceManager::IsMergingTimes() {
+	return fMergingTimes;
+}
+
+
 void TsSequenceManager::ExtraSequence(G4String extraSequenceFileSpec) {
 	// Loop to check for existance of this file on disk.
 	// If it is not present, sleep and then repeat the loop.
@@ -560,9 +599,78 @@ void TsSequenceManager::ExtraSequence(G4String extraSequenceFileSpec) {
 	}
 
 	G4cout << "\nPerforming Extra Sequence: " << extraSequenceFileSpec << G4endl;
+	ApplyParameterOverrides(extraSequenceFileSpec, infile, "ExtraSequence");
+
+	fPm->UpdateTimeFeatureStore();
+	UpdateForNewRunOrQtChange();
+	ClearGenerators();
+	Sequence();
+}
+
+
+// Runs one full sequence per sweep file. Physics, materials, geometry, sources and scorers are only set up once.
+// Each sweep file is applied on top of the original parameters, so only consumers of parameters changed by
+// the current or the previous sweep file need to be updated. Outputs are prefixed by the sweep file name.
+void TsSequenceManager::Sweep() {
+	G4String* sweepFileSpecs = fPm->GetStringVector("Ts/SweepFiles");
+	G4int numberOfSweepFiles = fPm->GetVectorLength("Ts/SweepFiles");
+
+	fIsSweeping = true;
+	fPm->SaveAddedParameters();
+
+	std::vector<G4String> previouslyChanged;
+	for (G4int iFile=0; iFile < numberOfSweepFiles; ++iFile) {
+		G4String sweepFileSpec = sweepFileSpecs[iFile];
+		std::ifstream infile(sweepFileSpec);
+		if (!infile) {
+			G4cerr << "Topas quitting. Unable to open sweep file: " << sweepFileSpec << G4endl;
+			G4cerr << "as specified in Ts/SweepFiles." << G4endl;
+			fPm->AbortSession(1);
+		}
+
+		G4cout << "\nPerforming Sweep: " << sweepFileSpec << G4endl;
+		fPm->RestoreAddedParameters();
+		for (size_t iName=0; iName < previouslyChanged.size(); ++iName)
+			UpdateForSpecificParameterChange(previouslyChanged[iName]);
+
+		previouslyChanged = ApplyParameterOverrides(sweepFileSpec, infile, "Sweep");
+
+		G4String prefix = sweepFileSpec;
+		size_t slashPos = prefix.find_last_of("/");
+		if (slashPos != std::string::npos)
+			prefix = prefix.substr(slashPos+1);
+		size_t dotPos = prefix.find_last_of(".");
+		if (dotPos != std::string::npos && dotPos > 0)
+			prefix = prefix.substr(0, dotPos);
+		fScm->SetOutputPrefix(prefix + "_");
+
+		fPm->UpdateTimeFeatureStore();
+
+		// Sources and scorers are set up after the first sweep file is applied, so they start from its values
+		if (fRunID == -1)
+			InitializeSequence();
+
+		UpdateForNewRunOrQtChange();
+		ClearGenerators();
+		Sequence();
+	}
+
+	fPm->RestoreAddedParameters();
+	for (size_t iName=0; iName < previouslyChanged.size(); ++iName)
+		UpdateForSpecificParameterChange(previouslyChanged[iName]);
+	fPm->UpdateTimeFeatureStore();
+	fScm->SetOutputPrefix("");
+	fIsSweeping = false;
+}
+
+
+// Adds the parameters from an ExtraSequence or Sweep file and notifies their consumers.
+// Returns the changed parameter names in the form passed to UpdateForSpecificParameterChange.
+std::vector<G4String> TsSequenceManager::ApplyParameterOverrides(const G4String& fileSpec, std::ifstream& infile, const G4String& fileType) {
+	std::vector<G4String> changedNames;
 	std::vector<G4String>* names = new std::vector<G4String>;
 	std::vector<G4String>* values = new std::vector<G4String>;
-	fPm->ReadFile(extraSequenceFileSpec, infile, names, values);
+	fPm->ReadFile(fileSpec, infile, names, values);
 
 	G4int length = names->size();
 	for (G4int iToken=0; iToken<length; iToken++) {
@@ -570,25 +678,22 @@ void TsSequenceManager::ExtraSequence(G4String extraSequenceFileSpec) {
 		G4String nameLower = name;
 		G4StrUtil::to_lower(nameLower);
 		if (nameLower == "includefile") {
-			G4cerr << "Topas quitting. ExtraSequence file contains IncludeFile." << G4endl;
-			G4cerr << "This is not permitted in an ExtraSequence file." << G4endl;
+			G4cerr << "Topas quitting. " << fileType << " file contains IncludeFile." << G4endl;
+			G4cerr << "This is not permitted in an " << fileType << " file." << G4endl;
 			exit(1);
 		}
 
 		G4String value = (*values)[iToken];
-		G4cout << "ExtraSequence updating parameter: " << name << " to value: " << value << G4endl;
+		G4cout << fileType << " updating parameter: " << name << " to value: " << value << G4endl;
 		fPm->AddParameter(name, value);
-		G4StrUtil::to_lower(name);
-		G4int colonPos = name.find( ":" );
-		UpdateForSpecificParameterChange(name.substr(colonPos+1));
+		G4int colonPos = nameLower.find( ":" );
+		changedNames.push_back(nameLower.substr(colonPos+1));
+		UpdateForSpecificParameterChange(changedNames.back());
 	}
 	delete names;
 	delete values;
 
-	fPm->UpdateTimeFeatureStore();
-	UpdateForNewRunOrQtChange();
-	ClearGenerators();
-	Sequence();
+	return changedNames;
 }
 
 
@@ -615,7 +720,9 @@ void TsSequenceManager::UpdateForSpecificParameterChange(const G4String& paramet
 {
 	if (fVerbosity > 0)
 		G4cout << "TsSequenceManager::UpdateForSpecificParameterChange called for parameterName: " << parameterName << G4endl;
-	
+
+	fPm->NoteParameterChangeForRun(parameterName);
+
 	fGm ->UpdateForSpecificParameterChange(parameterName);
 	fSom->UpdateForSpecificParameterChange(parameterName);
 	fFm ->UpdateForSpecificParameterChange(parameterName);
@@ -656,7 +763,8 @@ void TsSequenceManager::UpdateForNewRunOrQtChange() {
 	// This is needed to reattach scorers to any rebuilt components.
 	// Tell it not to reoptimize the full geometry (we elsewhere tell it which subsections
 	// we explicitly want to reoptimize).
-	if (fRunID > 0 && rebuiltSomeComponents) {
+	// A sweep may rebuild components before its first run, after the geometry was closed by initialization.
+	if ((fRunID > 0 || fIsSweeping) && rebuiltSomeComponents) {
 		SetGeometryToBeOptimized(false);
 		ReinitializeGeometry();
 	}
@@ -669,18 +777,10 @@ void TsSequenceManager::ClearGenerators() {
 		(*gIter)->ClearGenerators();
 }
 
-void TsSequenceManager::Run(G4double currentTime) {
-	// User hook for begin of run
-	fEm->BeginRun(fPm);
-
-	fTime = currentTime;
-
-	// For each run, loop over time features, advising all of the updatable managers of any changed time features.
-	// Each manager will pay attention only to those features it noted above.
-	G4String name;
-	G4bool found;
+// Loops over time features, returning the names of those whose values differ from the previous time
+std::vector<G4String> TsSequenceManager::FindChangedTimeFeatures(G4double currentTime) {
+	std::vector<G4String> changedParameters;
 	std::set<G4String> alreadyHandled;
-	std::set<G4String>::const_iterator iter;
 
 	std::vector<TsVParameter*>* timeFeatureStore = fPm->GetTimeFeatureStore(currentTime);
 	size_t tf_number = timeFeatureStore->size();
@@ -688,14 +788,7 @@ void TsSequenceManager::Run(G4double currentTime) {
 		TsVParameter* timeFeatureParameter = (*timeFeatureStore)[tf];
 
 	    // If the time feature occurs more than once in the hierarchy, only need to handle top instance
-	    name = timeFeatureParameter->GetName();
-	    found = false;
-	    for (iter=alreadyHandled.begin(); iter!=alreadyHandled.end() && !found; iter++)
-	        if (*iter == name)
-	            found = true;
-
-	    if (!found) {
-	        alreadyHandled.insert(name);
+	    if (alreadyHandled.insert(timeFeatureParameter->GetName()).second) {
 
 	        if ( timeFeatureParameter->ValueHasChanged() ) {
 
@@ -725,24 +818,51 @@ void TsSequenceManager::Run(G4double currentTime) {
 	            }
 
 	            G4String parameterName = timeFeatureParameter->GetName();
-	            UpdateForSpecificParameterChange(parameterName);
+	            changedParameters.push_back(parameterName);
 	        }
 	    }
 	}
 
+	return changedParameters;
+}
+
+
+void TsSequenceManager::Run(G4double currentTime) {
+	// User hook for begin of run
+	fEm->BeginRun(fPm);
+
+	fTime = currentTime;
+
+	// For each run, loop over time features, advising all of the updatable managers of any changed time features.
+	// Each manager will pay attention only to those features it noted above.
+	std::vector<G4String> changedParameters = FindChangedTimeFeatures(currentTime);
+	for (size_t iChange = 0; iChange < changedParameters.size(); ++iChange)
+		UpdateForSpecificParameterChange(changedParameters[iChange]);
+
 	// Advise all of the updateable managers that a new run is starting.
 	if ( fPm->GetIntegerParameter("Tf/Verbosity") > 1 ) G4cout << "Updating Time Features for time interval:" << currentTime/ms << G4endl;
 
 	UpdateForNewRunOrQtChange();
 
+	fPm->ReportUpdatesForRun(fRunID);
+
 	// Have to wait until after fSom update to retrieve the current number of histories in run.
 	G4int nEvents;
-	if (fPm->IsRandomMode())
+	if (fSampleTimePerEvent)
+		nEvents = (G4int)std::min(fSom->GetNumberOfHistoriesStillNeededInRandomJob(), (G4long)1E9);
+	else if (fPm->IsRandomMode())
 		nEvents = 1;
 	else
 		nEvents = fSom->GetNumberOfHistoriesInRun();
 
-	if ( fPm->GetIntegerParameter("Tf/Verbosity") > 0 ) fBCMFile << currentTime/ms <<" "<< nEvents <<std::endl;
+	NoteTimeInRun(nEvents);
+	BeamOnForRun(nEvents);
+}
+
+
+// Writes the per-time records: histories for the beam current file and any requested parameter dumps
+void TsSequenceManager::NoteTimeInRun(G4int nEvents) {
+	if ( fPm->GetIntegerParameter("Tf/Verbosity") > 0 ) fBCMFile << fTime/ms <<" "<< nEvents <<std::endl;
 
 	// Dump parameters to file if requested.
 	if (fPm->GetBooleanParameter("Ts/DumpParameters"))
@@ -753,7 +873,10 @@ void TsSequenceManager::Run(G4double currentTime) {
 		fPm->DumpParametersToSimpleFile(fTime);
 	if (fPm->ParameterExists("Ts/DumpParametersToSemicolonSeparatedFile"))
 		fPm->DumpParametersToSemicolonSeparatedFile(fTime);
+}
+
 
+void TsSequenceManager::BeamOnForRun(G4int nEvents) {
 #ifdef TOPAS_MT
 	if (G4MTRunManager::GetMasterRunManager()->GetNumberOfThreads() > 1) {
 		// Hand set the Geant4 "eventModulo". This is the number of events each worker should be given at any one time.
@@ -785,6 +908,178 @@ void TsSequenceManager::Run(G4double currentTime) {
 }
 
 
+// Runs the given sequential times with as few BeamOn calls as possible, so that workers stay in one event loop.
+// A later time joins the current run if its changes only affect generators and numbers of histories.
+// Any other change, such as to geometry or scoring, starts a new run. Each event works out its time from its event ID.
+void TsSequenceManager::RunMergedTimes(const std::vector<G4double>& times) {
+	std::vector<G4String> changedParameters = FindChangedTimeFeatures(times[0]);
+	size_t iTime = 0;
+	while (iTime < times.size()) {
+		// User hook for begin of run
+		fEm->BeginRun(fPm);
+
+		fTime = times[iTime];
+		for (size_t iChange = 0; iChange < changedParameters.size(); ++iChange)
+			UpdateForSpecificParameterChange(changedParameters[iChange]);
+
+		UpdateForNewRunOrQtChange();
+
+		fPm->ReportUpdatesForRun(fRunID);
+
+		fMergedTimes.clear();
+		fMergedFirstEvents.clear();
+		fMergedHistories.clear();
+		fMergedGeneratorParameters.clear();
+
+		G4int nEvents = 0;
+		while (true) {
+			G4int nEventsForTime = fSom->GetNumberOfHistoriesInRun();
+			fMergedTimes.push_back(fTime);
+			fMergedFirstEvents.push_back(nEvents);
+			fMergedHistories.push_back(fSom->GetNumberOfHistoriesInRunPerSource());
+			NoteTimeInRun(nEventsForTime);
+			nEvents += nEventsForTime;
+
+			if (++iTime == times.size())
+				break;
+
+			changedParameters = FindChangedTimeFeatures(times[iTime]);
+			if (!OnlyAffectsGenerators(changedParameters))
+				break;
+
+			fTime = times[iTime];
+			for (size_t iChange = 0; iChange < changedParameters.size(); ++iChange) {
+				fSom->UpdateForSpecificParameterChange(changedParameters[iChange]);
+				fMergedGeneratorParameters.insert(changedParameters[iChange]);
+			}
+			fSom->UpdateForNewRun(false);
+		}
+
+		if (fVerbosity > 0)
+			G4cout << "TsSequenceManager::RunMergedTimes running " << fMergedTimes.size() << " times in run: " << fRunID << G4endl;
+
+		fPm->UseThreadSequenceTimes(true);
+		fMergingTimes = true;
+		BeamOnForRun(nEvents);
+		fMergingTimes = false;
+		fPm->UseThreadSequenceTimes(false);
+
+		// Workers may have ended the run on any of the merged times, so have every generator resolve again
+		std::vector<TsGeneratorManager*>::iterator gIter;
+		std::set<G4String>::const_iterator pIter;
+		for (gIter=fGeneratorManagers.begin(); gIter!=fGeneratorManagers.end(); gIter++)
+			for (pIter=fMergedGeneratorParameters.begin(); pIter!=fMergedGeneratorParameters.end(); pIter++)
+				(*gIter)->UpdateForSpecificParameterChange(*pIter);
+	}
+}
+
+
+// True if the changes need nothing more than generators to update and sources to recount their histories
+G4bool TsSequenceManager::OnlyAffectsGenerators(const std::vector<G4String>& parameterNames) {
+	for (size_t iName = 0; iName < parameterNames.size(); ++iName) {
+		std::vector<std::pair<G4String,G4String> > consumers = fPm->GetParameterConsumers(parameterNames[iName]);
+		for (size_t iConsumer = 0; iConsumer < consumers.size(); ++iConsumer) {
+			G4String directParameterName = consumers[iConsumer].second;
+			G4StrUtil::to_lower(directParameterName);
+			size_t slashPos = directParameterName.find_last_of("/");
+			G4String directParameterEnd = directParameterName.substr(slashPos + 1);
+
+			if (consumers[iConsumer].first != "generator" &&
+				!(consumers[iConsumer].first == "source" && directParameterEnd == "numberofhistoriesinrun"))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+
+G4int TsSequenceManager::GetMergedTimeIndex(G4int eventID) {
+	std::vector<G4int>::const_iterator pos = std::upper_bound(fMergedFirstEvents.begin(), fMergedFirstEvents.end(), eventID);
+	return (G4int)(pos - fMergedFirstEvents.begin()) - 1;
+}
+
+
+// Called on the thread generating the event. Only that thread's generators and its view of the time are changed,
+// so workers on different merged times do not interfere.
+void TsSequenceManager::UpdateForMergedTime(TsGeneratorManager* pgM, G4int mergedTimeIndex) {
+	fPm->SetThreadSequenceTime(fMergedTimes[mergedTimeIndex]);
+
+	std::set<G4String>::const_iterator iter;
+	for (iter=fMergedGeneratorParameters.begin(); iter!=fMergedGeneratorParameters.end(); iter++)
+		pgM->UpdateForSpecificParameterChange(*iter);
+
+	pgM->UpdateForNewTime();
+}
+
+
+G4bool TsSequenceManager::SourceHasHistoryInMergedTime(G4int mergedTimeIndex, const G4String& sourceName, G4int eventID) {
+	std::map<G4String, G4int>::const_iterator iter = fMergedHistories[mergedTimeIndex].find(sourceName);
+	if (iter == fMergedHistories[mergedTimeIndex].end())
+		return false;
+
+	return eventID - fMergedFirstEvents[mergedTimeIndex] < iter->second;
+}
+
+
+// Time features can only change between the events of one run if all they affect is the sources,
+// the generators and the placement of components. Anything else still needs a run per history.
+G4bool TsSequenceManager::CanSampleTimePerEvent() {
+	std::vector<TsVParameter*>* timeFeatureStore = fPm->GetTimeFeatureStore(fTime);
+	for (size_t tf = 0; tf < timeFeatureStore->size(); ++tf) {
+		G4String parameterName = (*timeFeatureStore)[tf]->GetName();
+		std::vector<std::pair<G4String,G4String> > consumers = fPm->GetParameterConsumers(parameterName);
+		for (size_t iConsumer = 0; iConsumer < consumers.size(); ++iConsumer) {
+			G4String consumerType = consumers[iConsumer].first;
+			G4String directParameterName = consumers[iConsumer].second;
+			G4StrUtil::to_lower(directParameterName);
+			size_t slashPos = directParameterName.find_last_of("/");
+			G4String directParameterEnd = directParameterName.substr(slashPos + 1);
+
+			G4bool placementOnly = !fPm->GetBooleanParameter("Ts/FullRebuildTestMode") &&
+				(directParameterEnd == "transx" || directParameterEnd == "transy" || directParameterEnd == "transz" ||
+				 directParameterEnd == "rotx" || directParameterEnd == "roty" || directParameterEnd == "rotz");
+
+			if (consumerType != "source" && consumerType != "generator" && !(consumerType == "component" && placementOnly)) {
+				G4cout << "Tf/RandomizeTimePerEvent can not be honored since time feature: " << parameterName << G4endl;
+				G4cout << "affects " << consumerType << " parameter: " << directParameterName << G4endl;
+				G4cout << "TOPAS will instead do one run per history." << G4endl;
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+// Called on the thread generating the event. Random time mode is limited to one thread, so nothing else touches
+// the geometry or the sources while this runs.
+void TsSequenceManager::UpdateForNewEventTime(TsGeneratorManager* pgM) {
+	fTime = fRandomTimeStart + fRandomTimeInterval * G4UniformRand();
+
+	G4bool hadChange = false;
+	std::set<G4String> alreadyHandled;
+	std::vector<TsVParameter*>* timeFeatureStore = fPm->GetTimeFeatureStore(fTime);
+	for (size_t tf = 0; tf < timeFeatureStore->size(); ++tf) {
+		TsVParameter* timeFeatureParameter = (*timeFeatureStore)[tf];
+		if (alreadyHandled.insert(timeFeatureParameter->GetName()).second && timeFeatureParameter->ValueHasChanged()) {
+			G4String parameterName = timeFeatureParameter->GetName();
+			fGm->UpdateForSpecificParameterChange(parameterName);
+			fSom->UpdateForSpecificParameterChange(parameterName);
+			pgM->UpdateForSpecificParameterChange(parameterName);
+			hadChange = true;
+		}
+	}
+
+	if (hadChange) {
+		fGm->UpdateForNewRun(this, false);
+		fSom->UpdateForNewRun(false);
+		pgM->UpdateForNewTime();
+	}
+}
+
+
 G4int TsSequenceManager::GetRunID() {
 	return fRunID;
 }
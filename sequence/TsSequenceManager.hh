@@ -43,6 +43,8 @@
 #include "TsQt.hh"
 
 #include <vector>
+#include <map>
+#include <set>
 
 class TsParameterManager;
 class TsExtensionManager;
@@ -75,8 +77,11 @@ public:
 	void Sequence();
 
 	G4bool IsExecutingSequence();
+	G4bool IsSamplingTimePerEvent();
+	G4bool IsMergingTimes();
 
 	void ExtraSequence(G4String);
+	void Sweep();
 
 	void NoteAnyUseOfChangeableParameters(const G4String& name);
 
@@ -85,6 +90,10 @@ public:
 	void ClearGenerators();
 
 	void Run(G4double time);
+	void UpdateForNewEventTime(TsGeneratorManager* pgM);
+	G4int GetMergedTimeIndex(G4int eventID);
+	void UpdateForMergedTime(TsGeneratorManager* pgM, G4int mergedTimeIndex);
+	G4bool SourceHasHistoryInMergedTime(G4int mergedTimeIndex, const G4String& sourceName, G4int eventID);
 
 	G4int GetRunID();
 
@@ -105,6 +114,15 @@ public:
 	void AbortSession(G4int exitCode);
 
 private:
+	void InitializeSequence();
+	G4bool CanSampleTimePerEvent();
+	std::vector<G4String> FindChangedTimeFeatures(G4double currentTime);
+	G4bool OnlyAffectsGenerators(const std::vector<G4String>& parameterNames);
+	void RunMergedTimes(const std::vector<G4double>& times);
+	void NoteTimeInRun(G4int nEvents);
+	void BeamOnForRun(G4int nEvents);
+	std::vector<G4String> ApplyParameterOverrides(const G4String& fileSpec, std::ifstream& infile, const G4String& fileType);
+
 	TsParameterManager* fPm;
 	TsExtensionManager* fEm;
 	TsMaterialManager*  fMm;
@@ -159,6 +177,16 @@ private:
 	G4int fInterruptedHistoryMaxReports;
 
 	G4bool fIsExecutingSequence;
+	G4bool fIsSweeping;
+	G4bool fSampleTimePerEvent;
+	G4double fRandomTimeStart;
+	G4double fRandomTimeInterval;
+
+	G4bool fMergingTimes;
+	std::vector<G4double> fMergedTimes;
+	std::vector<G4int> fMergedFirstEvents;
+	std::vector<std::map<G4String, G4int> > fMergedHistories;
+	std::set<G4String> fMergedGeneratorParameters;
 
 	std::ofstream fBCMFile;
 };
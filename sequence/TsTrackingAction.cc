@@ -38,7 +38,7 @@
 #include "G4TrackingManager.hh"
 
 TsTrackingAction::TsTrackingAction(TsParameterManager* pM):
-fPm(pM), fInitialMomentum(0), fRequireSplitTrackID(false)
+fPm(pM), fInitialMomentum(0), fRequireSplitTrackID(false), fSetNeutronToStable(pM, "Ph/SetNeutronToStable")
 {
     if (fPm->ParameterExists("Vr/UseVarianceReduction") && fPm->GetBooleanParameter("Vr/UseVarianceReduction") &&
         fPm->ParameterExists("Vr/ParticleSplit/Active") && fPm->GetBooleanParameter("Vr/ParticleSplit/Active")) {
@@ -73,7 +73,7 @@ void TsTrackingAction::PreUserTrackingAction(const G4Track* aTrack)
 		newTrack->SetUserInformation(parentInformation);
 	}
 
-	if (fPm->GetBooleanParameter("Ph/SetNeutronToStable") &&
+	if (fSetNeutronToStable.Get() &&
 		aTrack->GetParticleDefinition()->GetParticleName() == "neutron")
 	{
 		newTrack = (G4Track*)aTrack;
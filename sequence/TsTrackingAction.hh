@@ -33,6 +33,8 @@
 
 #include "G4UserTrackingAction.hh"
 
+#include "TsParameterHandle.hh"
+
 #include "globals.hh"
 #include <vector>
 
@@ -60,6 +62,8 @@ private:
 	std::vector<TsVScorer*> fScorers;
     
     G4bool fRequireSplitTrackID;
+
+	TsBooleanParameterHandle fSetNeutronToStable;
 };
 
 #endif
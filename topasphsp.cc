@@ -0,0 +1,57 @@
+//
+// ********************************************************************
+// *                                                                  *
+// * Copyright 2024 The TOPAS Collaboration                           *
+// * Copyright 2022 The TOPAS Collaboration                           *
+// *                                                                  *
+// * Permission is hereby granted, free of charge, to any person      *
+// * obtaining a copy of this software and associated documentation   *
+// * files (the "Software"), to deal in the Software without          *
+// * restriction, including without limitation the rights to use,     *
+// * copy, modify, merge, publish, distribute, sublicense, and/or     *
+// * sell copies of the Software, and to permit persons to whom the   *
+// * Software is furnished to do so, subject to the following         *
+// * conditions:                                                      *
+// *                                                                  *
+// * The above copyright notice and this permission notice shall be   *
+// * included in all copies or substantial portions of the Software.  *
+// *                                                                  *
+// * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,  *
+// * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES  *
+// * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND         *
+// * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT      *
+// * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,     *
+// * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING     *
+// * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR    *
+// * OTHER DEALINGS IN THE SOFTWARE.                                  *
+// *                                                                  *
+// ********************************************************************
+//
+
+
+#include "TsParameterManager.hh"
+#include "TsPhaseSpaceToolkit.hh"
+#include "TsTopasConfig.hh"
+
+#include "G4UIcommand.hh"
+
+// Converts, merges, splits, filters or summarizes phase space files, as directed by the Ps/ parameters
+// in the parameter file given as the only argument. No simulation is set up.
+int main(int argc,char** argv) {
+	G4String topasVersion = G4UIcommand::ConvertToString(TOPAS_VERSION_MAJOR) + "." +
+	G4UIcommand::ConvertToString(TOPAS_VERSION_MINOR);
+	if (TOPAS_VERSION_PATCH > 0)
+		topasVersion = topasVersion + ".p" + G4UIcommand::ConvertToString(TOPAS_VERSION_PATCH);
+
+	std::cout << std::endl;
+	std::cout << "TOPAS Phase Space Toolkit (Version " << topasVersion << ")" << std::endl;
+
+	TsParameterManager* parameterManager = new TsParameterManager(argc, argv, topasVersion);
+
+	TsPhaseSpaceToolkit* toolkit = new TsPhaseSpaceToolkit(parameterManager);
+	toolkit->Run();
+
+	delete toolkit;
+	delete parameterManager;
+	return 0;
+}